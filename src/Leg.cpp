@@ -4,6 +4,9 @@
 #include "bodyConfiguration.hpp"
 #include <math.h>
 #include "vec2f.hpp"
+#include "fastMath.hpp"
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 #include <iostream>
 
@@ -11,220 +14,212 @@
 
 namespace hexapod
 {
-Leg::Leg(std::function<void(int, double)> servoFunction, int idx)
-    : m_servoFunction(servoFunction),
-    m_bodyHeight(50),
-    leg_position(on_ground),
-    currentLegrotationOffset_(0),
-    xPos_(0),
-    yPos_(0),
-    xCenterPos_(0),
-    yCenterPos_(0),
-    distanceFromGround_(0),
-    m_legIndex(idx),
-    movementConfiguration_(bodyConfiguration::HexapodMovementConfiguration::getDefaultSettings()),
-    frame_(bodyConfiguration::HexapodFrame::getConfiguredFrame())
+Leg::Leg(PlatformState &state, const KinematicModel &model,
+         const bodyConfiguration::HexapodMovementConfiguration &movementConfiguration, int idx)
+    : state_(&state),
+    model_(&model),
+    movementConfiguration_(&movementConfiguration),
+    m_legIndex(idx)
 {
-    //here the motor numbers for this leg
-    indexes_.push_back(idx * 3);
-    indexes_.push_back(idx * 3 + 1);
-    indexes_.push_back(idx * 3 + 2);
-    // it means leg look left of right when in math it`s degree is 0 but in real it`s servo 90
-    angleCOffsetAccordingToLegAttachment_ = -90;
+    if (idx < 0 || idx >= legsCount)
+        throw std::runtime_error("wrong leg number");
     //X - front, Y - left(or right)
-    // middle legs
-    if ((idx == RightMiddle) || (idx == LeftMiddle))
-    {
-        xCenterPos_ = 0;
-        yCenterPos_ = 100;
-    }
-
-    if ((idx == RightFront) || (idx == LeftFront))
-    {
-        xCenterPos_ = 70;
-        yCenterPos_ = 70;
-    }
-
-    if ((idx == RightBack) || (idx == LeftBack))
-    {
-        xCenterPos_ = -70;//-72-50;
-        yCenterPos_ = 70;
-    }
-
-    xPos_ = xCenterPos_;
-    yPos_ = yCenterPos_;
+    state_->xCenter[idx] = model_->centerX[idx];
+    state_->yCenter[idx] = model_->centerY[idx];
+    state_->xPos[idx] = state_->xCenter[idx];
+    state_->yPos[idx] = state_->yCenter[idx];
+    state_->height[idx] = 0;
+    state_->phase[idx] = on_ground;
+    state_->targetX[idx] = 0;
+    state_->targetY[idx] = 0;
 }
 
-void Leg::RecalcAngles()
+bool Leg::RecalcAngles()
 {
-    if (yPos_ == 0.0)
-        yPos_ = 0.01;
-    angleC_ = (atan(xPos_ / yPos_));  //this is angle between body and leg. Servo #2
-    double L1 = sqrt(xPos_ * xPos_ + yPos_ * yPos_); //L1 distance from leg attachment to point on ground in 2d
-    double L = sqrt(pow(m_bodyHeight, 2.0) + pow((L1 - frame_.cLegPart), 2));
-    if(L > (frame_.aLegPart + frame_.bLegPart))
+    double &xPos = state_->xPos[m_legIndex];
+    double &yPos = state_->yPos[m_legIndex];
+    const double bodyHeight = state_->bodyHeight;
+    if (yPos == 0.0)
+        yPos = 0.01;
+    double angleC = math::atan(xPos / yPos);  //this is angle between body and leg. Servo #2
+    double L1 = sqrt(xPos * xPos + yPos * yPos); //L1 distance from leg attachment to point on ground in 2d
+    double horizontal = L1 - model_->cLegPart;
+    double LSq = bodyHeight * bodyHeight + horizontal * horizontal;
+    double L = sqrt(LSq);
+    if(L > model_->maxReach)
     {
         //oops, we cannot solve this
         //lets just do nothing
-        return;
+        return false;
     }
     // angle alpfa
-    angleA_ = acos((m_bodyHeight - distanceFromGround_) / L) + acos(((pow(frame_.aLegPart, 2) - pow(frame_.bLegPart, 2) - pow(L, 2))) / (-2 * frame_.bLegPart * L));
+    double angleA = math::acos((bodyHeight - state_->height[m_legIndex]) / L) + math::acos((model_->aSqMinusBSq - LSq) / (model_->minusTwoB * L));
     // angle beta
-    angleB_ = acos((pow(L, 2) - pow(frame_.aLegPart, 2) - pow(frame_.bLegPart, 2)) / (-2 * frame_.aLegPart * frame_.bLegPart));
+    double angleB = math::acos((LSq - model_->aSqPlusBSq) / model_->minusTwoAB);
+    if (!std::isfinite(angleA) || !std::isfinite(angleB) || !std::isfinite(angleC))
+    {
+        // too close to the body or raised higher than body, do not send NaN to servos
+        return false;
+    }
 
-    // set angles directly to servos
-    angleA_ = angleA_ * 180 / 3.1415;
-    angleB_ = angleB_ * 180 / 3.1415;
-    angleC_ = angleC_ * 180 / 3.1415;
-    SetMotorAngle(0, angleA_);
-    SetMotorAngle(1, angleB_);
-    SetMotorAngle(2, angleC_);
+    // set angles directly to servos, all of them or none
+    state_->angleA[m_legIndex] = angleA * math::radToDeg;
+    state_->angleB[m_legIndex] = angleB * math::radToDeg;
+    state_->angleC[m_legIndex] = angleC * math::radToDeg;
+    SetMotorAngle(0, state_->angleA[m_legIndex]);
+    SetMotorAngle(1, state_->angleB[m_legIndex]);
+    SetMotorAngle(2, state_->angleC[m_legIndex]);
+    return true;
 }
 
 void Leg::SetLocalXY(double x, double y) // TODO
 {
-    xPos_ = x;
-    yPos_ = y;
+    state_->xPos[m_legIndex] = x;
+    state_->yPos[m_legIndex] = y;
 }
 
 void Leg::LegAddOffsetInGlobal(double xoffset, double yoffset)
 {
-    xPos_ -= xoffset;
-    if (m_legIndex < 3)
-    {
-        yPos_ += yoffset;
-    }
-    else
-    {
-        yPos_ -= yoffset;
-    }
+    state_->xPos[m_legIndex] -= xoffset;
+    state_->yPos[m_legIndex] += model_->side[m_legIndex] * yoffset;
 }
 
 void Leg::SetLegCoord(LegCoodinates &lc)
 {
     SetLocalXY(lc.x, lc.y);
-    distanceFromGround_ = lc.height;
+    state_->height[m_legIndex] = lc.height;
 }
 
 LegCoodinates Leg::GetLegCoord()
 {
-    LegCoodinates lc(xPos_, yPos_, distanceFromGround_);
+    LegCoodinates lc(state_->xPos[m_legIndex], state_->yPos[m_legIndex], state_->height[m_legIndex]);
     return lc;
 }
 
 double Leg::GetLegDirectionInGlobalCoordinates()
 {
-
-    switch (m_legIndex)
-    {
-    case RightMiddle:
-    case RightFront:
-    case RightBack:
-        return -90;
-    case LeftMiddle:
-    case LeftFront:
-    case LeftBack:
-        return 90;
-
-    default:
-        throw std::runtime_error("wrong leg number");
-        break;
-    }
+    return model_->directionInGlobal[m_legIndex];
 }
 
 void Leg::SetMotorAngle(int idx, double angle)
 {
     try {
-
-        float finalAngle = 0;
-        switch (idx)
-        {
-        case 0:
-            finalAngle = angle;
-
-            break;
-        case 1:
-            finalAngle = 180 - angle;
-            break;
-        case 2:
-            finalAngle = angle - angleCOffsetAccordingToLegAttachment_;
-            break;
-        default:
+        if (idx < 0 || idx >= jointsPerLeg)
             throw(std::runtime_error("Wrong motor index"));
-        }
-
-        if(finalAngle<0) finalAngle = 0;
-        if(finalAngle>180) finalAngle = 180;
-        m_servoFunction(indexes_[idx], finalAngle);
+        // mapping to real servo angle is done by ServoCalibration for whole frame
+        state_->jointAngles[model_->servos[m_legIndex][idx]] = angle;
     }
     catch(std::runtime_error& e)
     {
         std::cerr<<e.what()<<std::endl;
         std::cerr<<"error situation: "<<std::endl;
-        std::cerr<<" xPos = "<<xPos_<<" yPos = "<<yPos_<<std::endl;
+        std::cerr<<" xPos = "<<state_->xPos[m_legIndex]<<" yPos = "<<state_->yPos[m_legIndex]<<std::endl;
         std::cerr<<"angle = "<<angle<<" idx = "<<idx<<std::endl;
-        std::cerr<<"angleA = "<<angleA_<<std::endl;
-        std::cerr<<"angleB = "<<angleB_<<std::endl;
-        std::cerr<<"angleC = "<<angleC_<<std::endl;
-        std::cerr<<"m_bodyHeight = "<<m_bodyHeight<<" distanceFromGround_ = "<<distanceFromGround_<<std::endl;
+        std::cerr<<"angleA = "<<state_->angleA[m_legIndex]<<std::endl;
+        std::cerr<<"angleB = "<<state_->angleB[m_legIndex]<<std::endl;
+        std::cerr<<"angleC = "<<state_->angleC[m_legIndex]<<std::endl;
+        std::cerr<<"m_bodyHeight = "<<state_->bodyHeight<<" state_->height[m_legIndex] = "<<state_->height[m_legIndex]<<std::endl;
     }
 }
 
 double Leg::GetDistanceFromCenter()
 {
-    double xDist = fabs(xPos_ - xCenterPos_);
-    double yDist = fabs(yPos_ - yCenterPos_);
+    double xDist = fabs(state_->xPos[m_legIndex] - state_->xCenter[m_legIndex]);
+    double yDist = fabs(state_->yPos[m_legIndex] - state_->yCenter[m_legIndex]);
     return sqrt(xDist * xDist + yDist * yDist);
 }
 
 bool Leg::IsInCenter()
 {
-    if ((fabs(xPos_ - xCenterPos_) < 0.001) && (fabs(yPos_ - yCenterPos_) < 0.001))
+    if ((fabs(state_->xPos[m_legIndex] - state_->xCenter[m_legIndex]) < 0.001) && (fabs(state_->yPos[m_legIndex] - state_->yCenter[m_legIndex]) < 0.001))
         return true;
     return false;
 }
 
 void Leg::MoveLegUp()
 {
-    distanceFromGround_ = movementConfiguration_.stepHeight;
-    leg_position = moving_up;
+    state_->height[m_legIndex] = movementConfiguration_->stepHeight;
+    state_->phase[m_legIndex] = moving_up;
 }
 
 void Leg::MoveLegDown()
 {
-    distanceFromGround_ = 0;
-    leg_position = on_ground;
+    state_->height[m_legIndex] = 0;
+    state_->phase[m_legIndex] = on_ground;
 }
 
 void Leg::MoveLegToCenter()
 {
-    xPos_ = xCenterPos_;
-    yPos_ = yCenterPos_;
+    state_->xPos[m_legIndex] = state_->xCenter[m_legIndex];
+    state_->yPos[m_legIndex] = state_->yCenter[m_legIndex];
 }
 
 void Leg::MoveLegUp(vec2f newPositionOnGround)
 {
-    if (leg_position != on_ground)
+    if (state_->phase[m_legIndex] != on_ground)
         throw(std::runtime_error("try to move up leg that already in air"));
-    newPositionOnGround_ = newPositionOnGround;
-    distanceFromGround_ = movementConfiguration_.stepHeight;
-    leg_position = moving_up;
+    state_->targetX[m_legIndex] = newPositionOnGround.x;
+    state_->targetY[m_legIndex] = newPositionOnGround.y;
+    state_->height[m_legIndex] = movementConfiguration_->stepHeight;
+    state_->phase[m_legIndex] = moving_up;
 }
 
 void Leg::ProcessLegMovingInAir()
 {
-    if (leg_position == moving_up)
+    if (state_->phase[m_legIndex] == moving_up)
+    {
+        state_->phase[m_legIndex] = moving_to_target;
+        SetLocalXY(state_->targetX[m_legIndex], state_->targetY[m_legIndex]);
+        return;
+    }
+    // moving_down is left by a swing driven by contact source that was removed
+    if (state_->phase[m_legIndex] == moving_to_target || state_->phase[m_legIndex] == moving_down)
+    {
+        state_->phase[m_legIndex] = on_ground;
+        state_->height[m_legIndex] = 0;
+    }
+}
+
+void Leg::ProcessSwing(bool contact, int descentSteps)
+{
+    unsigned char &phase = state_->phase[m_legIndex];
+    double &height = state_->height[m_legIndex];
+    if (phase == moving_up || phase == moving_to_target)
     {
-        leg_position = moving_to_target;
-        SetLocalXY(newPositionOnGround_.x, newPositionOnGround_.y);
+        // foot just left the ground, contact is not trusted yet: carry it over the target on step height
+        SetLocalXY(state_->targetX[m_legIndex], state_->targetY[m_legIndex]);
+        phase = moving_down;
         return;
     }
-    if (leg_position == moving_to_target)
+    // contact is for the height foot had on previous tick, it is checked before every lowering
+    if (contact || height <= 0)
     {
-        leg_position = on_ground;
-        distanceFromGround_ = 0;
+        phase = on_ground;
+        return;
     }
+    height = std::max(0.0, height - movementConfiguration_->stepHeight / descentSteps);
+    // on flat floor foot touches in the tick it reaches ground level, waiting for contact is a lost tick
+    phase = height > 0 ? moving_down : on_ground;
+}
+
+Leg::LegPosition Leg::GetLegPosition()
+{
+    return static_cast<LegPosition>(state_->phase[m_legIndex]);
+}
+
+void Leg::SetLegPosition(LegPosition position)
+{
+    state_->phase[m_legIndex] = static_cast<unsigned char>(position);
+}
+
+double Leg::GetBodyHeight()
+{
+    return state_->bodyHeight;
+}
+
+void Leg::SetBodyHeight(double height)
+{
+    state_->bodyHeight = height;
 }
 
 int Leg::GetLegIndex()
@@ -234,12 +229,12 @@ int Leg::GetLegIndex()
 
 vec2f Leg::GetCenterVec()
 {
-    return vec2f(xCenterPos_, yCenterPos_);
+    return vec2f(state_->xCenter[m_legIndex], state_->yCenter[m_legIndex]);
 }
 
 double Leg::GetLegLocalZAngle()
 {
-    return angleC_;
+    return state_->angleC[m_legIndex];
 }
 // Next 3 methods are needed for rotation
 
@@ -254,37 +249,8 @@ void Leg::TurnLegWithGlobalCoord(double offset)
 vec2f Leg::GetLegGlobalCoord()
 {
     vec2f res;
-
-    switch (m_legIndex)
-    {
-    case RightMiddle:
-        res.x = xPos_;
-        res.y = yPos_ + frame_.centerYOffset;
-        break;
-    case LeftMiddle:
-        res.x = xPos_;
-        res.y = -yPos_ - frame_.centerYOffset;
-        break;
-    case RightFront:
-        res.x = xPos_ + frame_.rearXOffset;
-        res.y = yPos_ + frame_.rearYOffset;
-        break;
-    case RightBack:
-        res.x = xPos_ - frame_.rearXOffset;
-        res.y = yPos_ + frame_.rearYOffset;
-        break;
-    case LeftFront:
-        res.x = xPos_ + frame_.rearXOffset;
-        res.y = -yPos_ - frame_.rearYOffset;
-        break;
-    case LeftBack:
-        res.x = xPos_ - frame_.rearXOffset;
-        res.y = -yPos_ - frame_.rearYOffset;
-        break;
-
-    default:
-        break;
-    }
+    res.x = state_->xPos[m_legIndex] + model_->mountX[m_legIndex];
+    res.y = model_->side[m_legIndex] * (state_->yPos[m_legIndex] + model_->mountY[m_legIndex]);
     return res;
 }
 
@@ -293,39 +259,8 @@ vec2f Leg::GetLegGlobalCoord()
 vec2f Leg::GlobalToLocal(vec2f &lc)
 {
     vec2f res;
-    switch (m_legIndex)
-    {
-
-    case RightMiddle:
-        res.x = lc.x;
-        res.y = lc.y - frame_.centerYOffset;
-        break;
-    case LeftMiddle:
-        res.x = lc.x;
-        res.y = -lc.y - frame_.centerYOffset;
-        break;
-
-    case RightFront:
-        res.x = lc.x - frame_.rearXOffset;
-        res.y = lc.y - frame_.rearYOffset;
-        break;
-    case RightBack:
-        res.x = lc.x + frame_.rearXOffset;
-        res.y = lc.y - frame_.rearYOffset;
-        break;
-
-    case LeftFront:
-        res.x = lc.x - frame_.rearXOffset;
-        res.y = -lc.y - frame_.rearYOffset;
-        break;
-    case LeftBack:
-        res.x = lc.x + frame_.rearXOffset;
-        res.y = -lc.y - frame_.rearYOffset;
-        break;
-
-    default:
-        break;
-    }
+    res.x = lc.x - model_->mountX[m_legIndex];
+    res.y = model_->side[m_legIndex] * lc.y - model_->mountY[m_legIndex];
     return res;
 };
 }
@@ -1,8 +1,8 @@
 #pragma once
-#include <vector>
-#include <functional>
 #include "vec2f.hpp"
 #include "bodyConfiguration.hpp"
+#include "robotDescription.hpp"
+#include "platformState.hpp"
 
 
 namespace hexapod
@@ -33,15 +33,21 @@ namespace hexapod
         double height;
     };
 
+    /*!
+     * \brief Leg - view on one leg of PlatformState. It is cheap to copy,
+     *        all data lives in the state and configuration owned by Platform
+     */
     class Leg
     {
     public:
-        Leg(std::function<void(int, double)> servoFunction, int legIndex);
+        Leg(PlatformState &state, const KinematicModel &model,
+            const bodyConfiguration::HexapodMovementConfiguration &movementConfiguration, int legIndex);
         /*!
          * \brief RecalcAngles update new servo angles depending on a end of a leg position.
          *        Needed to be called after and leg coordinates changes
+         * \return false if position can not be reached, old joint angles (A, B and C) are kept then
          */
-        void RecalcAngles();
+        bool RecalcAngles();
         /*!
          * \brief SetLocalXY this method control leg end position
          */
@@ -73,8 +79,23 @@ namespace hexapod
          */
         void MoveLegToCenter();        
         void MoveLegUp(vec2f newPositionOnGround);
+        /*!
+         * \brief SetMotorAngle - put joint angle in degrees into the state frame,
+         *        idx is a joint number 0..2 (A, B, C)
+         */
         void SetMotorAngle(int idx, double angle);
+        /*!
+         * \brief ProcessLegMovingInAir - fixed swing: foot goes to target on first tick and lands on second.
+         *        Foot being lowered by ProcessSwing lands at once
+         */
         void ProcessLegMovingInAir();
+        /*!
+         * \brief ProcessSwing - swing driven by foot contact: foot goes over its target on step height,
+         *        then on every next tick it lands if contact is reported, otherwise it is lowered by
+         *        stepHeight/descentSteps and lands when it reaches ground level, so the swing takes
+         *        1 + descentSteps ticks on flat floor. Foot stays on the height where it touched
+         */
+        void ProcessSwing(bool contact, int descentSteps);
         int GetLegIndex();
         vec2f GetCenterVec();
         double GetDistanceFromCenter();
@@ -85,36 +106,27 @@ namespace hexapod
             moving_up,
             moving_to_target,
             moving_down
-        } leg_position;
-        double m_bodyHeight;
+        };
+        // replace former public members leg_position and m_bodyHeight, data lives in PlatformState
+        LegPosition GetLegPosition();
+        void SetLegPosition(LegPosition position);
+        // body height is common for all legs of the platform
+        double GetBodyHeight();
+        void SetBodyHeight(double height);
         LegCoodinates GetLegCoord();
     private:
         // convert global coordinates to local for this leg
         vec2f GlobalToLocal(vec2f &lc);
         // get Leg angle
         double GetLegDirectionInGlobalCoordinates();
-        // this is needed only for rotating procesure
-        float currentLegrotationOffset_;
         double GetLegLocalZAngle();
         vec2f GetLegGlobalCoord();
 
     private:
-        std::function<void(int, double)> m_servoFunction;
-        volatile double xPos_;
-        volatile double yPos_;
-        double xCenterPos_;
-        double yCenterPos_;
-        vec2f newPositionOnGround_;
-        double distanceFromGround_;
-        // output, angles in radians
-        double angleA_;
-        double angleB_;
-        double angleC_;
-        // setted servos numbers
-        std::vector<int> indexes_;
+        PlatformState *state_;
+        // geometry shared by all legs, servo numbers are there too
+        const KinematicModel *model_;
+        const bodyConfiguration::HexapodMovementConfiguration *movementConfiguration_;
         int m_legIndex;
-        float angleCOffsetAccordingToLegAttachment_;
-        bodyConfiguration::HexapodMovementConfiguration movementConfiguration_;
-        bodyConfiguration::HexapodFrame frame_;
     };
 }
@@ -0,0 +1,66 @@
+#include "configFile.hpp"
+#include <fstream>
+
+namespace hexapod
+{
+ConfigFile::ConfigFile(const std::string &fileName, int line, const std::string &key, const std::string &values)
+    : m_fileName(fileName)
+    , m_line(line)
+    , m_key(key)
+    , m_values(values)
+{
+}
+
+void ConfigFile::parse(const std::string &fileName,
+                       std::function<void(const std::string &, ConfigFile &)> entryHandler)
+{
+    std::ifstream file(fileName);
+    if (!file)
+        throw std::runtime_error("cannot open " + fileName);
+
+    std::string text;
+    int lineNumber = 0;
+    while (std::getline(file, text))
+    {
+        ++lineNumber;
+        size_t comment = text.find('#');
+        if (comment != std::string::npos)
+            text.erase(comment);
+        size_t equal = text.find('=');
+        std::istringstream keyStream(text.substr(0, equal));
+        std::string key;
+        if (!(keyStream >> key))
+            continue; // empty line
+        ConfigFile entry(fileName, lineNumber, key,
+                         equal == std::string::npos ? std::string() : text.substr(equal + 1));
+        if (equal == std::string::npos)
+            throw entry.error("expected key = value");
+        entryHandler(key, entry);
+    }
+}
+
+bool ConfigFile::splitIndexedKey(const std::string &key, const std::string &prefix,
+                                 int &index, std::string &field)
+{
+    if (key.compare(0, prefix.size(), prefix) != 0)
+        return false;
+    size_t pos = prefix.size();
+    size_t dot = key.find('.', pos);
+    if (dot == std::string::npos || dot == pos || dot - pos > 3 || dot + 1 == key.size())
+        return false;
+    index = 0;
+    for (size_t i = pos; i < dot; ++i)
+    {
+        if (key[i] < '0' || key[i] > '9')
+            return false;
+        index = index * 10 + (key[i] - '0');
+    }
+    field = key.substr(dot + 1);
+    return true;
+}
+
+std::runtime_error ConfigFile::error(const std::string &what) const
+{
+    return std::runtime_error(m_fileName + ":" + std::to_string(m_line) + ": " + what);
+}
+}
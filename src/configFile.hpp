@@ -0,0 +1,74 @@
+#pragma once
+
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace hexapod
+{
+    /*!
+     * \brief ConfigFile - reader for simple "key = values" text files.
+     *        '#' starts a comment, empty lines are skipped
+     */
+    class ConfigFile
+    {
+    public:
+        /*!
+         * \brief parse - calls entryHandler for every "key = values" line.
+         *        Throws std::runtime_error if file can not be opened or line has no '='
+         */
+        static void parse(const std::string &fileName,
+                          std::function<void(const std::string &key, ConfigFile &entry)> entryHandler);
+
+        /*!
+         * \brief splitIndexedKey - split key like "leg.3.center" into index 3 and field "center"
+         * \return false if key does not start with prefix followed by a number and a field
+         */
+        static bool splitIndexedKey(const std::string &key, const std::string &prefix,
+                                    int &index, std::string &field);
+
+        /*!
+         * \brief read - read exactly count values of current entry
+         */
+        template <typename T>
+        void read(T *out, int count)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                if (!(m_values >> out[i]))
+                    throw error("expected " + std::to_string(count) + " values for " + m_key);
+            }
+            std::string rest;
+            if (m_values >> rest)
+                throw error("too many values for " + m_key);
+        }
+
+        /*!
+         * \brief readAll - read all values of current entry, at least one
+         */
+        template <typename T, typename Container>
+        void readAll(Container &out)
+        {
+            out.clear();
+            T value;
+            while (m_values >> value)
+                out.push_back(value);
+            if (!m_values.eof() || out.empty())
+                throw error("wrong values for " + m_key);
+        }
+
+        /*!
+         * \brief error - exception with file name and line number of current entry
+         */
+        std::runtime_error error(const std::string &what) const;
+
+    private:
+        ConfigFile(const std::string &fileName, int line, const std::string &key, const std::string &values);
+
+        std::string m_fileName;
+        int m_line;
+        std::string m_key;
+        std::istringstream m_values;
+    };
+}
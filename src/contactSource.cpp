@@ -0,0 +1,74 @@
+#include "contactSource.hpp"
+#include <stdexcept>
+
+namespace hexapod
+{
+namespace
+{
+const double contactTolerance = 0.001;
+}
+
+ContactSource::~ContactSource()
+{
+}
+
+CallbackContactSource::CallbackContactSource(std::function<bool(int leg)> contactFunction)
+    : m_contactFunction(contactFunction)
+{
+    if (!m_contactFunction)
+        throw std::runtime_error("contact function is empty");
+}
+
+unsigned CallbackContactSource::read(const PlatformState &)
+{
+    unsigned contacts = 0;
+    for (int leg = 0; leg < legsCount; ++leg)
+    {
+        if (m_contactFunction(leg))
+            contacts |= 1u << leg;
+    }
+    return contacts;
+}
+
+PolledContactSource::PolledContactSource()
+    : m_contacts(0)
+{
+}
+
+void PolledContactSource::set(int leg, bool contact)
+{
+    if (leg < 0 || leg >= legsCount)
+        throw std::runtime_error("wrong leg number");
+    if (contact)
+        m_contacts.fetch_or(1u << leg, std::memory_order_release);
+    else
+        m_contacts.fetch_and(~(1u << leg), std::memory_order_release);
+}
+
+void PolledContactSource::setAll(unsigned contacts)
+{
+    m_contacts.store(contacts, std::memory_order_release);
+}
+
+unsigned PolledContactSource::read(const PlatformState &)
+{
+    return m_contacts.load(std::memory_order_acquire);
+}
+
+SimulatedContactSource::SimulatedContactSource(Terrain terrain)
+    : m_terrain(terrain)
+{
+}
+
+unsigned SimulatedContactSource::read(const PlatformState &state)
+{
+    unsigned contacts = 0;
+    for (int leg = 0; leg < legsCount; ++leg)
+    {
+        double ground = m_terrain ? m_terrain(leg, state.xPos[leg], state.yPos[leg]) : 0;
+        if (state.height[leg] <= ground + contactTolerance)
+            contacts |= 1u << leg;
+    }
+    return contacts;
+}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "platformState.hpp"
+#include <atomic>
+#include <functional>
+
+namespace hexapod
+{
+    /*!
+     * \brief ContactSource - foot contact sensors, read once at the start of every planner tick
+     */
+    class ContactSource
+    {
+    public:
+        virtual ~ContactSource();
+        /*!
+         * \brief read - bit per leg, set if foot touches something
+         * \param state - feet commanded on previous tick, only simulation needs it
+         */
+        virtual unsigned read(const PlatformState &state) = 0;
+    };
+
+    /*!
+     * \brief CallbackContactSource - asks user function for every leg
+     */
+    class CallbackContactSource : public ContactSource
+    {
+    public:
+        explicit CallbackContactSource(std::function<bool(int leg)> contactFunction);
+        unsigned read(const PlatformState &state) override;
+
+    private:
+        std::function<bool(int leg)> m_contactFunction;
+    };
+
+    /*!
+     * \brief PolledContactSource - bit array updated by sensor thread or interrupt handler
+     */
+    class PolledContactSource : public ContactSource
+    {
+    public:
+        PolledContactSource();
+        void set(int leg, bool contact);
+        void setAll(unsigned contacts);
+        unsigned read(const PlatformState &state) override;
+
+    private:
+        std::atomic<unsigned> m_contacts;
+    };
+
+    /*!
+     * \brief SimulatedContactSource - foot touches terrain when its commanded height
+     *        is not above terrain height under the foot
+     */
+    class SimulatedContactSource : public ContactSource
+    {
+    public:
+        // terrain height for leg and foot position in leg local coordinates
+        typedef std::function<double(int leg, double x, double y)> Terrain;
+
+        /*!
+         * \brief SimulatedContactSource - flat floor if terrain is not given
+         */
+        explicit SimulatedContactSource(Terrain terrain = Terrain());
+        unsigned read(const PlatformState &state) override;
+
+    private:
+        Terrain m_terrain;
+    };
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cmath>
+
+// Accuracy of trigonometry used by kinematics, selected at compile time:
+// 0 - libm, 1 - balanced polynomials, 2 - fast polynomials (see CMake option HEXAPOD_MATH_ACCURACY)
+#ifndef HEXAPOD_MATH_ACCURACY
+#define HEXAPOD_MATH_ACCURACY 0
+#endif
+
+namespace hexapod
+{
+namespace math
+{
+    constexpr double PI = 3.14159265358979323846;
+    constexpr double degToRad = PI / 180.0;
+    constexpr double radToDeg = 180.0 / PI;
+
+    /*!
+     * Accuracy tiers, max absolute error against libm measured on 10^7 points of the whole domain:
+     *            atan2       acos        sincos (|x| < 1000)
+     * Libm       0           0           0
+     * Balanced   1.2e-5      2.2e-8      2.7e-9
+     * Fast       1.51e-3     6.8e-5      6.8e-4
+     * Polynomials have no branches (only selects), so batch versions below are vectorized by compiler.
+     * Bounds are checked by tests/fastMathTest.cpp.
+     */
+    enum Accuracy
+    {
+        Libm = 0,
+        Balanced = 1,
+        Fast = 2
+    };
+
+    constexpr Accuracy defaultAccuracy = static_cast<Accuracy>(HEXAPOD_MATH_ACCURACY);
+
+    namespace detail
+    {
+        // atan on [0, 1]
+        inline double atanUnit(double t, Accuracy accuracy)
+        {
+            if (accuracy == Fast)
+                return t * (PI / 4) - t * (t - 1) * (0.2447 + 0.0663 * t);
+            // Abramowitz & Stegun 4.4.49
+            const double t2 = t * t;
+            return t * (0.9998660 + t2 * (-0.3302995 + t2 * (0.1801410 + t2 * (-0.0851330 + t2 * 0.0208351))));
+        }
+
+        // acos on [0, 1]
+        inline double acosUnit(double x, Accuracy accuracy)
+        {
+            if (accuracy == Fast) // Abramowitz & Stegun 4.4.45
+                return std::sqrt(1 - x) * (1.5707288 + x * (-0.2121144 + x * (0.0742610 + x * -0.0187293)));
+            // Abramowitz & Stegun 4.4.46
+            return std::sqrt(1 - x) * (1.5707963050 + x * (-0.2145988016 + x * (0.0889789874 + x * (-0.0501743046
+                   + x * (0.0308918810 + x * (-0.0170881256 + x * (0.0066700901 + x * -0.0012624911)))))));
+        }
+
+        // round to nearest without library call, valid for |x| < 2^51
+        inline double roundNearest(double x)
+        {
+            const double magic = 6755399441055744.0; // 1.5 * 2^52
+            return (x + magic) - magic;
+        }
+    }
+
+    template <Accuracy accuracy = defaultAccuracy>
+    inline double atan2(double y, double x)
+    {
+        if (accuracy == Libm)
+            return std::atan2(y, x);
+        const double ax = std::fabs(x);
+        const double ay = std::fabs(y);
+        // comparisons are turned into 0/1 factors, selects with arithmetic would stop vectorization
+        const double yBigger = static_cast<double>(ay > ax);
+        const double xNegative = static_cast<double>(x < 0);
+        const double big = ay > ax ? ay : ax;
+        const double small = ay > ax ? ax : ay;
+        // smallest normal number keeps 0/0 away and does not change any other result
+        double r = detail::atanUnit(small / (big + 2.2250738585072014e-308), accuracy);
+        // PI/2 - r if |y| > |x|
+        r = yBigger * (PI / 2) + (1 - 2 * yBigger) * r;
+        // PI - r if x < 0
+        r = xNegative * PI + (1 - 2 * xNegative) * r;
+        return std::copysign(r, y);
+    }
+
+    template <Accuracy accuracy = defaultAccuracy>
+    inline double atan(double x)
+    {
+        if (accuracy == Libm)
+            return std::atan(x);
+        return atan2<accuracy>(x, 1.0);
+    }
+
+    template <Accuracy accuracy = defaultAccuracy>
+    inline double acos(double x)
+    {
+        if (accuracy == Libm)
+            return std::acos(x);
+        const double r = detail::acosUnit(std::fabs(x), accuracy);
+        // PI - r for negative x, without select
+        return PI / 2 - std::copysign(PI / 2 - r, x);
+    }
+
+    template <Accuracy accuracy = defaultAccuracy>
+    inline void sincos(double x, double &sinX, double &cosX)
+    {
+        if (accuracy == Libm)
+        {
+            sinX = std::sin(x);
+            cosX = std::cos(x);
+            return;
+        }
+        // reduce to [-PI/4, PI/4], PI/2 is split in two parts to keep precision
+        const double q = detail::roundNearest(x * (2 / PI));
+        const double r = (x - q * 1.57079632673412561417) - q * 6.07710050650619224932e-11;
+        const double z = r * r;
+        double s;
+        double c;
+        if (accuracy == Fast)
+        {
+            s = r * (1 + z * (-0.16605 + z * 0.00761));
+            c = 1 + z * (-0.49670 + z * 0.03705);
+        }
+        else
+        {
+            // coefficients from Cephes sinf/cosf
+            s = r + r * z * (-1.6666654611e-1 + z * (8.3321608736e-3 + z * -1.9515295891e-4));
+            c = 1 - 0.5 * z + z * z * (4.166664568298827e-2 + z * (-1.388731625493765e-3 + z * 2.443315711809948e-5));
+        }
+        // quadrant q mod 4 in [-2, 2]
+        const double m = q - 4 * detail::roundNearest(q * 0.25);
+        const double am = std::fabs(m);
+        const bool swap = am == 1;
+        const bool sinNegative = am == 2 || m == -1;
+        const bool cosNegative = am == 2 || m == 1;
+        const double sv = swap ? c : s;
+        const double cv = swap ? s : c;
+        sinX = sinNegative ? -sv : sv;
+        cosX = cosNegative ? -cv : cv;
+    }
+
+    // batch versions for arrays, loops are vectorized when accuracy is not Libm
+    // (acos needs -fno-math-errno, otherwise sqrt keeps a branch for errno)
+
+    template <Accuracy accuracy = defaultAccuracy>
+    inline void atan2(const double *y, const double *x, double *out, int count)
+    {
+        for (int i = 0; i < count; ++i)
+            out[i] = atan2<accuracy>(y[i], x[i]);
+    }
+
+    // not vectorized by GCC: with constant 1 as x of atan2 it turns the selects back into branches
+    template <Accuracy accuracy = defaultAccuracy>
+    inline void atan(const double *x, double *out, int count)
+    {
+        for (int i = 0; i < count; ++i)
+            out[i] = atan<accuracy>(x[i]);
+    }
+
+    template <Accuracy accuracy = defaultAccuracy>
+    inline void acos(const double *x, double *out, int count)
+    {
+        for (int i = 0; i < count; ++i)
+            out[i] = acos<accuracy>(x[i]);
+    }
+
+    template <Accuracy accuracy = defaultAccuracy>
+    inline void sincos(const double *x, double *sinX, double *cosX, int count)
+    {
+        for (int i = 0; i < count; ++i)
+            sincos<accuracy>(x[i], sinX[i], cosX[i]);
+    }
+}
+}
@@ -0,0 +1,235 @@
+#include "gaitCache.hpp"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace hexapod
+{
+namespace
+{
+const double velocityQuantum = 0.01;
+const double heightQuantum = 0.1;
+// unordered_map node with hash and pointers, rough size
+const size_t indexEntryBytes = 4 * sizeof(void *) + sizeof(std::uint64_t) + sizeof(int);
+
+template <typename T, size_t N>
+bool sameArray(const T (&a)[N], const T (&b)[N])
+{
+    return std::memcmp(a, b, sizeof(a)) == 0;
+}
+
+// bitwise, padding of the state is not compared
+bool sameState(const PlatformState &a, const PlatformState &b)
+{
+    return sameArray(a.xPos, b.xPos) && sameArray(a.yPos, b.yPos) && sameArray(a.height, b.height)
+           && sameArray(a.phase, b.phase) && sameArray(a.targetX, b.targetX) && sameArray(a.targetY, b.targetY)
+           && sameArray(a.xCenter, b.xCenter) && sameArray(a.yCenter, b.yCenter)
+           && sameArray(a.angleA, b.angleA) && sameArray(a.angleB, b.angleB) && sameArray(a.angleC, b.angleC)
+           && sameArray(a.jointAngles, b.jointAngles)
+           && std::memcmp(&a.bodyHeight, &b.bodyHeight, sizeof(a.bodyHeight)) == 0;
+}
+
+bool sameCommand(const GaitCommand &a, const GaitCommand &b)
+{
+    return a.velocityX == b.velocityX && a.velocityY == b.velocityY && a.rotation == b.rotation
+           && a.bodyHeight == b.bodyHeight && a.stepStyle == b.stepStyle;
+}
+
+void hashBytes(std::uint64_t &hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;  // FNV-1a
+    }
+}
+
+// feet and phases define the gait, the rest is checked by sameState()
+std::uint64_t hashState(const PlatformState &state)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    hashBytes(hash, state.xPos, sizeof(state.xPos));
+    hashBytes(hash, state.yPos, sizeof(state.yPos));
+    hashBytes(hash, state.height, sizeof(state.height));
+    hashBytes(hash, state.phase, sizeof(state.phase));
+    return hash;
+}
+}
+
+bool GaitCache::Key::operator==(const Key &other) const
+{
+    return velocityX == other.velocityX && velocityY == other.velocityY && rotation == other.rotation
+           && bodyHeight == other.bodyHeight && stepStyle == other.stepStyle;
+}
+
+size_t GaitCache::KeyHash::operator()(const Key &key) const
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    hashBytes(hash, &key.velocityX, sizeof(key.velocityX));
+    hashBytes(hash, &key.velocityY, sizeof(key.velocityY));
+    hashBytes(hash, &key.rotation, sizeof(key.rotation));
+    hashBytes(hash, &key.bodyHeight, sizeof(key.bodyHeight));
+    hashBytes(hash, &key.stepStyle, sizeof(key.stepStyle));
+    return static_cast<size_t>(hash);
+}
+
+GaitCache::GaitCache(size_t budgetBytes, int maxCycleTicks)
+    : m_budget(budgetBytes)
+    , m_maxCycleTicks(maxCycleTicks)
+    , m_command()
+    , m_key()
+    , m_hasCommand(false)
+    , m_playing(nullptr)
+    , m_nextFrame(0)
+    , m_stats()
+{
+    if (maxCycleTicks < 1)
+        throw std::runtime_error("gait cycle length must be positive");
+    m_recorded.reserve(maxCycleTicks + 1);
+}
+
+GaitCache::Key GaitCache::makeKey(const GaitCommand &command)
+{
+    Key key;
+    key.velocityX = std::llround(command.velocityX / velocityQuantum);
+    key.velocityY = std::llround(command.velocityY / velocityQuantum);
+    key.rotation = std::llround(command.rotation / velocityQuantum);
+    key.bodyHeight = std::llround(command.bodyHeight / heightQuantum);
+    key.stepStyle = command.stepStyle;
+    return key;
+}
+
+bool GaitCache::play(const GaitCommand &command, PlatformState &state)
+{
+    if (!m_hasCommand || !sameCommand(command, m_command))
+    {
+        invalidate();
+        m_command = command;
+        m_key = makeKey(command);
+        m_hasCommand = true;
+    }
+    if (m_playing)
+    {
+        const int framesCount = static_cast<int>(m_playing->frames.size());
+        const PlatformState &played = m_playing->frames[(m_nextFrame + framesCount - 1) % framesCount];
+        if (sameState(state, played))
+        {
+            state = m_playing->frames[m_nextFrame];
+            m_nextFrame = (m_nextFrame + 1) % framesCount;
+            ++m_stats.hits;
+            return true;
+        }
+        // state was changed outside of the planner
+        invalidate();
+    }
+    ++m_stats.misses;
+    return false;
+}
+
+void GaitCache::record(const PlatformState &state)
+{
+    if (!m_hasCommand)
+        return;
+    const std::uint64_t hash = hashState(state);
+
+    // join known cycle
+    auto cycle = m_cycles.find(m_key);
+    if (cycle != m_cycles.end() && sameCommand(cycle->second.command, m_command))
+    {
+        auto frame = cycle->second.index.find(hash);
+        if (frame != cycle->second.index.end() && sameState(cycle->second.frames[frame->second], state))
+        {
+            m_playing = &cycle->second;
+            m_nextFrame = (frame->second + 1) % static_cast<int>(m_playing->frames.size());
+            m_lru.splice(m_lru.begin(), m_lru, m_playing->lruPosition);
+            m_recorded.clear();
+            m_recordedIndex.clear();
+            return;
+        }
+    }
+
+    // or find a new one, gait may settle into other cycle than stored one
+    auto repeated = m_recordedIndex.find(hash);
+    if (repeated != m_recordedIndex.end() && sameState(m_recorded[repeated->second], state))
+    {
+        m_recorded.push_back(state);
+        store(repeated->second + 1, static_cast<int>(m_recorded.size()));
+        m_recorded.clear();
+        m_recordedIndex.clear();
+        return;
+    }
+    if (static_cast<int>(m_recorded.size()) >= m_maxCycleTicks)
+    {
+        // too long or not periodic yet, start again after the transient
+        m_recorded.clear();
+        m_recordedIndex.clear();
+    }
+    m_recordedIndex[hash] = static_cast<int>(m_recorded.size());
+    m_recorded.push_back(state);
+}
+
+void GaitCache::store(int from, int to)
+{
+    const size_t framesCount = to - from;
+    const size_t bytes = framesCount * (sizeof(PlatformState) + indexEntryBytes) + sizeof(Cycle);
+    auto old = m_cycles.find(m_key);
+    if (old != m_cycles.end())
+    {
+        // recorded with other command in the same quantum
+        m_stats.bytes -= old->second.bytes;
+        m_lru.erase(old->second.lruPosition);
+        m_cycles.erase(old);
+    }
+    if (bytes > m_budget)
+        return;
+    while (m_stats.bytes + bytes > m_budget)
+        evict();
+
+    Cycle &cycle = m_cycles[m_key];
+    cycle.command = m_command;
+    cycle.frames.assign(m_recorded.begin() + from, m_recorded.begin() + to);
+    for (size_t i = 0; i < framesCount; ++i)
+        cycle.index.emplace(hashState(cycle.frames[i]), static_cast<int>(i));
+    m_lru.push_front(m_key);
+    cycle.lruPosition = m_lru.begin();
+    cycle.bytes = bytes;
+    m_stats.bytes += bytes;
+    ++m_stats.cycles;
+
+    // current state is the last frame
+    m_playing = &cycle;
+    m_nextFrame = 0;
+}
+
+void GaitCache::evict()
+{
+    auto cycle = m_cycles.find(m_lru.back());
+    m_stats.bytes -= cycle->second.bytes;
+    m_cycles.erase(cycle);
+    m_lru.pop_back();
+    ++m_stats.evictions;
+}
+
+void GaitCache::invalidate()
+{
+    m_playing = nullptr;
+    m_nextFrame = 0;
+    m_recorded.clear();
+    m_recordedIndex.clear();
+}
+
+void GaitCache::clear()
+{
+    invalidate();
+    m_hasCommand = false;
+    m_cycles.clear();
+    m_lru.clear();
+    m_stats.bytes = 0;
+}
+
+GaitCache::Stats GaitCache::getStats() const
+{
+    return m_stats;
+}
+}
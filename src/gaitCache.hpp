@@ -0,0 +1,112 @@
+#pragma once
+
+#include "platformState.hpp"
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace hexapod
+{
+    /*!
+     * \brief GaitCommand - everything that drives the gait planner on a tick
+     */
+    struct GaitCommand
+    {
+        double velocityX;
+        double velocityY;
+        double rotation;
+        double bodyHeight;
+        int stepStyle;  // Platform::StepStyle
+    };
+
+    /*!
+     * \brief GaitCache - remembers periodic gait cycles of steady commands and plays them back
+     *        instead of planning and solving IK again.
+     *        While a command is steady, states after every tick are recorded until a state repeats,
+     *        frames between the two equal states are one gait cycle. Cycles are stored for commands
+     *        quantized to 0.01 (velocity, rotation) and 0.1 (height), total size is limited by budget,
+     *        least recently used cycles are dropped first.
+     *        Playback is exact: frame is used only if state is equal to the previous played frame
+     */
+    class GaitCache
+    {
+    public:
+        struct Stats
+        {
+            unsigned long long hits;      // ticks played from cache
+            unsigned long long misses;    // ticks planned
+            unsigned long long cycles;    // cycles recorded
+            unsigned long long evictions;
+            size_t bytes;                 // memory used by stored cycles
+        };
+
+        /*!
+         * \brief GaitCache
+         * \param budgetBytes - memory for stored cycles
+         * \param maxCycleTicks - longer cycles are not searched for
+         */
+        explicit GaitCache(size_t budgetBytes, int maxCycleTicks = 256);
+        /*!
+         * \brief play - put next frame of cached cycle into state
+         * \return false if tick must be planned, then record() is expected after it
+         */
+        bool play(const GaitCommand &command, PlatformState &state);
+        /*!
+         * \brief record - give planned state, it is used to find or join a cycle
+         */
+        void record(const PlatformState &state);
+        /*!
+         * \brief invalidate - stop playback and recording, stored cycles are kept.
+         *        Needed when something not in GaitCommand changes gait
+         */
+        void invalidate();
+        /*!
+         * \brief clear - drop everything
+         */
+        void clear();
+        Stats getStats() const;
+
+    private:
+        struct Key
+        {
+            long long velocityX;
+            long long velocityY;
+            long long rotation;
+            long long bodyHeight;
+            int stepStyle;
+            bool operator==(const Key &other) const;
+        };
+        struct KeyHash
+        {
+            size_t operator()(const Key &key) const;
+        };
+        struct Cycle
+        {
+            GaitCommand command;  // exact command the cycle was recorded with
+            std::vector<PlatformState> frames;
+            std::unordered_map<std::uint64_t, int> index;  // state hash -> frame
+            std::list<Key>::iterator lruPosition;
+            size_t bytes;
+        };
+
+        static Key makeKey(const GaitCommand &command);
+        void store(int from, int to);
+        void evict();
+
+        size_t m_budget;
+        int m_maxCycleTicks;
+        // steady command and what happens with it now
+        GaitCommand m_command;
+        Key m_key;
+        bool m_hasCommand;
+        Cycle *m_playing;
+        int m_nextFrame;
+        // states planned with current command while no cycle is known
+        std::vector<PlatformState> m_recorded;
+        std::unordered_map<std::uint64_t, int> m_recordedIndex;
+        std::unordered_map<Key, Cycle, KeyHash> m_cycles;
+        std::list<Key> m_lru;  // most recently used first
+        Stats m_stats;
+    };
+}
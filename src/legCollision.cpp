@@ -0,0 +1,151 @@
+#include "legCollision.hpp"
+#include "fastMath.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace hexapod
+{
+namespace
+{
+double dot(const double *a, const double *b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+double clamp01(double value)
+{
+    return std::min(std::max(value, 0.0), 1.0);
+}
+
+// squared distance between segments p1-q1 and p2-q2, see C.Ericson "Real-Time Collision Detection" 5.1.9
+double segmentsDistanceSq(const double *p1, const double *q1, const double *p2, const double *q2)
+{
+    const double epsilon = 1e-9;
+    double d1[3] = {q1[0] - p1[0], q1[1] - p1[1], q1[2] - p1[2]};
+    double d2[3] = {q2[0] - p2[0], q2[1] - p2[1], q2[2] - p2[2]};
+    double r[3] = {p1[0] - p2[0], p1[1] - p2[1], p1[2] - p2[2]};
+    double a = dot(d1, d1);
+    double e = dot(d2, d2);
+    double f = dot(d2, r);
+    double s = 0;
+    double t = 0;
+    if (a <= epsilon && e <= epsilon)
+    {
+        // both segments are points
+    }
+    else if (a <= epsilon)
+    {
+        t = clamp01(f / e);
+    }
+    else
+    {
+        double c = dot(d1, r);
+        if (e <= epsilon)
+        {
+            s = clamp01(-c / a);
+        }
+        else
+        {
+            double b = dot(d1, d2);
+            double denom = a * e - b * b;
+            s = (denom > epsilon) ? clamp01((b * f - c * e) / denom) : 0;
+            t = (b * s + f) / e;
+            if (t < 0)
+            {
+                t = 0;
+                s = clamp01(-c / a);
+            }
+            else if (t > 1)
+            {
+                t = 1;
+                s = clamp01((b - c) / a);
+            }
+        }
+    }
+    double diff[3];
+    for (int i = 0; i < 3; ++i)
+        diff[i] = (p1[i] + d1[i] * s) - (p2[i] + d2[i] * t);
+    return dot(diff, diff);
+}
+}
+
+LegCollision::LegCollision(const KinematicModel &model, double femurRadius, double tibiaRadius)
+    : m_model(&model)
+    , m_femurRadius(femurRadius)
+    , m_tibiaRadius(tibiaRadius)
+    , m_capsules()
+{
+}
+
+void LegCollision::update(const PlatformState &state)
+{
+    for (int leg = 0; leg < legsCount; ++leg)
+    {
+        const double angleA = state.angleA[leg] * math::degToRad;
+        const double angleB = state.angleB[leg] * math::degToRad;
+        const double angleC = state.angleC[leg] * math::degToRad;
+        const double side = m_model->side[leg];
+        double sinA, cosA, sinAB, cosAB, sinC, cosC;
+        math::sincos(angleA, sinA, cosA);
+        math::sincos(angleA + angleB, sinAB, cosAB);
+        math::sincos(angleC, sinC, cosC);
+        // horizontal direction of the leg plane in body coordinates
+        const double dirX = sinC;
+        const double dirY = side * cosC;
+        // joints positions in the leg plane: distance from attachment and height
+        const double coxaEnd = m_model->cLegPart;
+        const double kneeR = coxaEnd + m_model->bLegPart * sinA;
+        const double kneeZ = -m_model->bLegPart * cosA;
+        const double footR = kneeR - m_model->aLegPart * sinAB;
+        const double footZ = kneeZ + m_model->aLegPart * cosAB;
+
+        const double mountX = m_model->mountX[leg];
+        const double mountY = side * m_model->mountY[leg];
+        const double points[4][3] = {
+            {mountX, mountY, 0},
+            {mountX + dirX * coxaEnd, mountY + dirY * coxaEnd, 0},
+            {mountX + dirX * kneeR, mountY + dirY * kneeR, kneeZ},
+            {mountX + dirX * footR, mountY + dirY * footR, footZ}};
+        const double radius[segmentsCount] = {m_femurRadius, m_femurRadius, m_tibiaRadius};
+        for (int segment = 0; segment < segmentsCount; ++segment)
+        {
+            Capsule &capsule = m_capsules[leg][segment];
+            std::copy(points[segment], points[segment] + 3, capsule.from);
+            std::copy(points[segment + 1], points[segment + 1] + 3, capsule.to);
+            capsule.radius = radius[segment];
+        }
+    }
+}
+
+unsigned LegCollision::check() const
+{
+    unsigned colliding = 0;
+    // legs are numbered around the body, so neighbors are i and i + 1
+    for (int leg = 0; leg < legsCount; ++leg)
+    {
+        int neighbor = (leg + 1) % legsCount;
+        for (int first = femur; first <= tibia; ++first)
+        {
+            for (int second = femur; second <= tibia; ++second)
+            {
+                const Capsule &a = m_capsules[leg][first];
+                const Capsule &b = m_capsules[neighbor][second];
+                double minDistance = a.radius + b.radius;
+                if (segmentsDistanceSq(a.from, a.to, b.from, b.to) < minDistance * minDistance)
+                    colliding |= (1u << leg) | (1u << neighbor);
+            }
+        }
+    }
+    return colliding;
+}
+
+const Capsule &LegCollision::getCapsule(int leg, Segment segment) const
+{
+    return m_capsules[leg][segment];
+}
+
+double LegCollision::distance(const Capsule &first, const Capsule &second)
+{
+    return sqrt(segmentsDistanceSq(first.from, first.to, second.from, second.to)) - first.radius - second.radius;
+}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "platformState.hpp"
+#include "robotDescription.hpp"
+
+namespace hexapod
+{
+    /*!
+     * \brief Capsule - segment with radius, bounding volume of one leg part.
+     *        Body coordinates: X - front, Y - left, Z - up, origin in body center
+     */
+    struct Capsule
+    {
+        double from[3];
+        double to[3];
+        double radius;
+    };
+
+    /*!
+     * \brief LegCollision - checks that neighbor legs do not touch each other.
+     *        Capsules are built from inverse kinematics output (joint angles in PlatformState),
+     *        so they show where servos really put the leg
+     */
+    class LegCollision
+    {
+    public:
+        enum Segment
+        {
+            coxa = 0,
+            femur,
+            tibia,
+            segmentsCount
+        };
+
+        LegCollision(const KinematicModel &model, double femurRadius = 15, double tibiaRadius = 10);
+        /*!
+         * \brief update - rebuild capsules of all legs from joint angles
+         */
+        void update(const PlatformState &state);
+        /*!
+         * \brief check - test femur and tibia of adjacent legs
+         * \return bit mask of legs touching a neighbor, 0 if there is no collision
+         */
+        unsigned check() const;
+        const Capsule &getCapsule(int leg, Segment segment) const;
+        /*!
+         * \brief distance - distance between capsules surfaces, negative if they intersect
+         */
+        static double distance(const Capsule &first, const Capsule &second);
+
+    private:
+        const KinematicModel *m_model;
+        double m_femurRadius;
+        double m_tibiaRadius;
+        Capsule m_capsules[legsCount][segmentsCount];
+    };
+}
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "platform.hpp"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <thread>
 #include <cmath>
+#include <stdexcept>
 
 namespace hexapod
 {
@@ -23,76 +25,170 @@ This is schematic of a robot motors positions
 */
 namespace
 {
-const double PI = 3.141592654;
 const double minimumDistanceStep = 30; // TODO requires experiments
 }
 
 // place legs in compact position for transportation
 void Platform::parkLegs()
 {
+    stopMovementThread();
     for (unsigned int i = 0; i < 6; ++i)
     {
         m_legs[i].SetMotorAngle(0, 180);
         m_legs[i].SetMotorAngle(1, 0);
         m_legs[i].SetMotorAngle(2, 0);
     }
+    outputServos();
 
 }
 
 void Platform::setVelocity(const vec2f movementSpeed, const double rotationSpeed)
 {
+    if (m_active)
+    {
+        ++m_requestedSettings.velocityVersion;
+        m_requestedSettings.movementSpeed = movementSpeed;
+        m_requestedSettings.rotationSpeed = rotationSpeed;
+        publishSettings();
+        return;
+    }
     m_movementSpeed = movementSpeed;
     m_rotationSpeed = rotationSpeed;
 }
 
 void Platform::setWalkingStyle(StepStyle style)
 {
+    if (m_active)
+    {
+        ++m_requestedSettings.stepStyleVersion;
+        m_requestedSettings.stepStyle = style;
+        publishSettings();
+        return;
+    }
     m_stepStyle = style;
 }
 
 Platform::Platform(std::function<void(int)> sleepMsFuction,
                    std::function<void(int, double)> servoPositionFunction,
-                   int kinematic_period)
-    : m_rotationSpeed(0.0f)
+                   int kinematic_period,
+                   std::shared_ptr<const KinematicModel> model)
+    : m_state()
+    , m_model(model)
+    , m_movementConfiguration(bodyConfiguration::HexapodMovementConfiguration::getDefaultSettings())
+    , m_rotationSpeed(0.0f)
     , m_movementSpeed(0.0f, 0.0f)
     , m_sleepMsFunction(sleepMsFuction)
+    , m_servoFunction(servoPositionFunction)
+    , m_calibration()
+    , m_collision(*model)
+    , m_collisionCheck(false)
+    , m_collisionStats()
+    , m_velocityLimiter()
+    , m_velocityLimit(false)
+    , m_descentSteps(1)
+    , m_ikFailures(0)
+    , m_rejectedCommands(0)
+    , m_diagnostics()
     , m_active(false)
+    , m_requestedSettings()
+    , m_appliedSettings()
+    , m_publishedBodyHeight(model->bodyHeight)
     , m_stepStyle(OneLeg)
     , m_kinematicPeriod(kinematic_period)
+    , m_plannerPeriod(kinematic_period)
+    , m_outputPeriod(kinematic_period)
+    , m_outputState()
 {
-    for (int i = 0; i < 6; ++i)
+    m_state.bodyHeight = m_model->bodyHeight;
+    setServoCalibration(ServoCalibration(model));
+    m_legs.reserve(legsCount);
+    for (int i = 0; i < legsCount; ++i)
+    {
+        // legs write joint angles into the state frame, it is sent by outputServos()
+        m_legs.push_back(Leg(m_state, *m_model, m_movementConfiguration, i));
+    }
+    // legs are in centers now, fill the frame so it never has garbage
+    for (Leg &currentLeg : m_legs)
     {
-        Leg leg(servoPositionFunction, i);
-        m_legs.push_back(leg);
+        currentLeg.RecalcAngles();
     }
+    // output stage of multi-rate mode solves IK for interpolated feet on its own copy
+    m_outputState = m_state;
+    publishDiagnostics();
+}
+
+Platform::~Platform()
+{
+    stopMovementThread();
 }
 
 void Platform::setBodyHeight(const float height)
 {
+    if (m_active)
+    {
+        ++m_requestedSettings.bodyHeightVersion;
+        m_requestedSettings.bodyHeight = height;
+        publishSettings();
+        return;
+    }
+    m_state.bodyHeight = height;
+    m_publishedBodyHeight = m_state.bodyHeight;
     for (size_t i = 0; i < 6; ++i)
     {
-        m_legs[i].m_bodyHeight = height;
         m_legs[i].RecalcAngles();
     }
-    m_bodyHeight = height;
+    outputServos();
 }
 
 float Platform::getBodyHeight() const
 {
-    return m_bodyHeight;
+    return m_publishedBodyHeight;
 }
 
 void Platform::startMovementThread()
 {
     if(m_active) return;
     m_active = true;
-    std::thread movement(&Platform::movementThread,this);
-    movement.detach();
+    m_movementThread = std::thread(&Platform::movementThread, this);
+}
+
+void Platform::startMultiRateThreads(int plannerPeriod, int outputPeriod)
+{
+    if(m_active) return;
+    m_active = true;
+    m_plannerPeriod = plannerPeriod;
+    m_outputPeriod = outputPeriod;
+    clearGaitCache();  // velocity limiter depends on period
+    m_plannerThread = std::thread(&Platform::plannerThread, this);
+    m_outputThread = std::thread(&Platform::outputThread, this);
 }
 
 void Platform::stopMovementThread()
 {
     m_active = false;
+    if (m_plannerThread.joinable() && m_plannerThread.get_id() != std::this_thread::get_id())
+        m_plannerThread.join();
+    if (m_outputThread.joinable() && m_outputThread.get_id() != std::this_thread::get_id())
+        m_outputThread.join();
+    if (m_movementThread.joinable() && m_movementThread.get_id() != std::this_thread::get_id())
+        m_movementThread.join();
+    // settings sent after the last planner tick are not lost
+    applyPendingSettings();
+    if (m_plannerPeriod != m_kinematicPeriod)
+    {
+        m_plannerPeriod = m_kinematicPeriod;
+        clearGaitCache();
+    }
+}
+
+StageTiming Platform::getPlannerTiming() const
+{
+    return m_plannerTimer.get();
+}
+
+StageTiming Platform::getOutputTiming() const
+{
+    return m_outputTimer.get();
 }
 
 void Platform::movingEnd()
@@ -104,6 +200,7 @@ void Platform::movingEnd()
             m_legs[i].RecalcAngles();
         }
     }
+    outputServos();
 }
 /*!
      * \brief Platform::getLegToRaise - find most suitable leg to raise (most far from center)
@@ -162,18 +259,61 @@ void Platform::raiseThreeLegs(int legToRaise)
 
 void Platform::procedureGo()
 {
+    planStep();
+    outputServos();
+}
+
+void Platform::planStep()
+{
+    m_plannerTimer.start();
+    applyPendingSettings();
+    if (m_sharedMemory)
+    {
+        applySharedCommand();
+    }
+    const bool useGaitCache = m_gaitCache && !m_contactSource;
+    bool played = false;
+    if (useGaitCache)
+    {
+        GaitCommand command = {m_movementSpeed.x, m_movementSpeed.y, m_rotationSpeed, m_state.bodyHeight, m_stepStyle};
+        played = m_gaitCache->play(command, m_state);
+    }
+    if (!played)
+    {
+        planGait();
+        if (useGaitCache)
+            m_gaitCache->record(m_state);
+    }
+    m_plannerTimer.stop();
+    m_publishedBodyHeight = m_state.bodyHeight;
+    publishDiagnostics();
+    if (m_sharedMemory)
+    {
+        publishTelemetry();
+    }
+}
+
+void Platform::planGait()
+{
+    const PlatformState previous = m_state;
+    // sensors see feet where they were sent on previous tick
+    const unsigned contacts = m_contactSource ? m_contactSource->read(m_state) : 0;
+    // legs on a ground - move them as needed
+    moveGroundedLegsLimited(previous);
     bool anyLegInAir = false;
     for (Leg &currentLeg : m_legs)
     {
-        if (currentLeg.leg_position != Leg::on_ground) //for leg in air - move it to center
+        if (currentLeg.GetLegPosition() != Leg::on_ground) //for leg in air - move it to center
         {
-            anyLegInAir = true;
-            currentLeg.ProcessLegMovingInAir();
-        }
-        else // leg on a ground - move it as needed
-        {
-            currentLeg.LegAddOffsetInGlobal(m_movementSpeed.x, m_movementSpeed.y);
-            currentLeg.TurnLegWithGlobalCoord( m_rotationSpeed );
+            if (!m_contactSource)
+            {
+                anyLegInAir = true;
+                currentLeg.ProcessLegMovingInAir();
+                continue;
+            }
+            // leg that touched down can be followed by next step right now
+            currentLeg.ProcessSwing(contacts & (1u << currentLeg.GetLegIndex()), m_descentSteps);
+            anyLegInAir = anyLegInAir || currentLeg.GetLegPosition() != Leg::on_ground;
         }
     }
     if (!anyLegInAir) // all 6 legs on the ground, we check, do we need to raise any leg?
@@ -197,10 +337,294 @@ void Platform::procedureGo()
             }
         }
     }
+    m_ikFailures += solveLegs(m_state, *m_model);
+    if (m_collisionCheck)
+    {
+        resolveCollisions(previous);
+    }
+}
+
+void Platform::moveGroundedLegsLimited(const PlatformState &previous)
+{
+    if (!m_velocityLimit)
+    {
+        moveGroundedLegs(m_state, *m_model, m_movementSpeed.x, m_movementSpeed.y, m_rotationSpeed);
+        return;
+    }
+    m_velocityLimiter.limit(*m_model, previous, m_state, m_movementSpeed.x, m_movementSpeed.y, m_rotationSpeed, m_plannerPeriod);
+}
+
+void Platform::resolveCollisions(const PlatformState &previous)
+{
+    ++m_collisionStats.checks;
+    m_collision.update(m_state);
+    unsigned colliding = m_collision.check();
+    if (colliding == 0)
+        return;
+
+    // veto body movement - legs on the ground stay where they were
+    ++m_collisionStats.vetoes;
+    bool anyLegInAir = false;
+    int legToRaise = -1;
+    double maxDist = -1;
     for (Leg &currentLeg : m_legs)
     {
-        currentLeg.RecalcAngles();
+        int i = currentLeg.GetLegIndex();
+        if (currentLeg.GetLegPosition() != Leg::on_ground)
+        {
+            anyLegInAir = true;
+            continue;
+        }
+        if (previous.phase[i] == Leg::on_ground)
+        {
+            m_state.xPos[i] = previous.xPos[i];
+            m_state.yPos[i] = previous.yPos[i];
+        }
+        // touching leg most far from center makes a step
+        double curDist = currentLeg.GetDistanceFromCenter();
+        if ((colliding & (1u << i)) && curDist > maxDist)
+        {
+            maxDist = curDist;
+            legToRaise = i;
+        }
+    }
+    if (!anyLegInAir && legToRaise != -1)
+    {
+        raiseOneLeg(legToRaise);
     }
+    // adjusted feet may be out of reach too, they are counted as any other
+    m_ikFailures += solveLegs(m_state, *m_model);
+
+    // legs in air go to their centers, so they are not stopped even if still touching
+    m_collision.update(m_state);
+    if (m_collision.check() != 0)
+    {
+        ++m_collisionStats.unresolved;
+    }
+}
+
+void Platform::setCollisionCheck(bool enabled, double femurRadius, double tibiaRadius)
+{
+    if (m_active)
+    {
+        ++m_requestedSettings.collisionVersion;
+        m_requestedSettings.collisionCheck = enabled;
+        m_requestedSettings.femurRadius = femurRadius;
+        m_requestedSettings.tibiaRadius = tibiaRadius;
+        publishSettings();
+        return;
+    }
+    m_collision = LegCollision(*m_model, femurRadius, tibiaRadius);
+    m_collisionCheck = enabled;
+    clearGaitCache();
+}
+
+Platform::CollisionStats Platform::getCollisionStats() const
+{
+    Diagnostics diagnostics;
+    m_diagnostics.read(diagnostics);
+    return diagnostics.collisionStats;
+}
+
+void Platform::setVelocityLimiter(const VelocityLimiter &limiter, bool enabled)
+{
+    if (m_active)
+    {
+        ++m_requestedSettings.velocityLimiterVersion;
+        m_requestedSettings.velocityLimiter = limiter;
+        m_requestedSettings.velocityLimit = enabled;
+        publishSettings();
+        return;
+    }
+    m_velocityLimiter = limiter;
+    m_velocityLimit = enabled;
+    clearGaitCache();
+    publishDiagnostics();
+}
+
+VelocityLimiter::Report Platform::getVelocityLimiterReport() const
+{
+    Diagnostics diagnostics;
+    m_diagnostics.read(diagnostics);
+    return diagnostics.velocityLimiterReport;
+}
+
+void Platform::attachSharedMemory(const std::string &name)
+{
+    m_sharedMemory.reset();
+    m_sharedMemory.reset(new SharedMemoryServer(name));
+    publishTelemetry();
+}
+
+void Platform::detachSharedMemory()
+{
+    m_sharedMemory.reset();
+}
+
+void Platform::setContactSource(std::shared_ptr<ContactSource> source, int descentSteps)
+{
+    if (descentSteps < 1)
+        throw std::runtime_error("descent steps must be positive");
+    if (m_active)
+    {
+        ++m_requestedSettings.contactVersion;
+        m_requestedSettings.contactSource = source;
+        m_requestedSettings.descentSteps = descentSteps;
+        publishSettings();
+        return;
+    }
+    m_contactSource = source;
+    m_descentSteps = descentSteps;
+    clearGaitCache();
+}
+
+void Platform::enableGaitCache(size_t budgetBytes)
+{
+    if (budgetBytes == 0)
+        m_gaitCache.reset();
+    else
+        m_gaitCache.reset(new GaitCache(budgetBytes));
+    publishDiagnostics();
+}
+
+GaitCache::Stats Platform::getGaitCacheStats() const
+{
+    Diagnostics diagnostics;
+    m_diagnostics.read(diagnostics);
+    return diagnostics.gaitCacheStats;
+}
+
+unsigned long long Platform::getIkFailures() const
+{
+    Diagnostics diagnostics;
+    m_diagnostics.read(diagnostics);
+    return diagnostics.ikFailures;
+}
+
+unsigned long long Platform::getRejectedCommands() const
+{
+    Diagnostics diagnostics;
+    m_diagnostics.read(diagnostics);
+    return diagnostics.rejectedCommands;
+}
+
+const PlatformState &Platform::getState() const
+{
+    return m_state;
+}
+
+void Platform::applyPendingSettings()
+{
+    if (!m_settings.update())
+        return;
+    const Settings &settings = m_settings.readBuffer();
+    if (settings.velocityVersion != m_appliedSettings.velocityVersion)
+    {
+        m_movementSpeed = settings.movementSpeed;
+        m_rotationSpeed = settings.rotationSpeed;
+    }
+    if (settings.stepStyleVersion != m_appliedSettings.stepStyleVersion)
+        m_stepStyle = settings.stepStyle;
+    if (settings.bodyHeightVersion != m_appliedSettings.bodyHeightVersion)
+        m_state.bodyHeight = settings.bodyHeight;  // angles are recalculated on this tick
+    for (int i = 0; i < legsCount; ++i)
+    {
+        if (settings.legVersion[i] == m_appliedSettings.legVersion[i])
+            continue;
+        m_legs[i].SetLocalXY(settings.legPosition[i].x, settings.legPosition[i].y);
+        if (settings.legPosition[i].height > 0)
+            m_legs[i].MoveLegUp();
+        clearGaitCache();  // recorded cycles do not have this leg position
+    }
+    if (settings.collisionVersion != m_appliedSettings.collisionVersion)
+    {
+        m_collision = LegCollision(*m_model, settings.femurRadius, settings.tibiaRadius);
+        m_collisionCheck = settings.collisionCheck;
+        clearGaitCache();
+    }
+    if (settings.velocityLimiterVersion != m_appliedSettings.velocityLimiterVersion)
+    {
+        m_velocityLimiter = settings.velocityLimiter;
+        m_velocityLimit = settings.velocityLimit;
+        clearGaitCache();
+    }
+    if (settings.contactVersion != m_appliedSettings.contactVersion)
+    {
+        m_contactSource = settings.contactSource;
+        m_descentSteps = settings.descentSteps;
+        clearGaitCache();
+    }
+    m_appliedSettings = settings;
+}
+
+void Platform::publishDiagnostics()
+{
+    Diagnostics diagnostics;
+    diagnostics.ikFailures = m_ikFailures;
+    diagnostics.rejectedCommands = m_rejectedCommands;
+    diagnostics.collisionStats = m_collisionStats;
+    diagnostics.velocityLimiterReport = m_velocityLimiter.getReport();
+    diagnostics.gaitCacheStats = m_gaitCache ? m_gaitCache->getStats() : GaitCache::Stats();
+    m_diagnostics.write(diagnostics);
+}
+
+void Platform::publishSettings()
+{
+    m_settings.writeBuffer() = m_requestedSettings;
+    m_settings.publish();
+}
+
+void Platform::clearGaitCache()
+{
+    if (m_gaitCache)
+        m_gaitCache->clear();
+}
+
+void Platform::applySharedCommand()
+{
+    SharedCommand command;
+    if (!m_sharedMemory->pollCommand(command))
+        return;
+    // one bad value would stay in feet positions forever
+    if (!std::isfinite(command.velocityX) || !std::isfinite(command.velocityY) || !std::isfinite(command.rotation)
+        || !std::isfinite(command.bodyHeight) || command.bodyHeight <= 0)
+    {
+        ++m_rejectedCommands;
+        return;
+    }
+    m_movementSpeed = vec2f(command.velocityX, command.velocityY);
+    m_rotationSpeed = command.rotation;
+    m_state.bodyHeight = command.bodyHeight;  // angles are recalculated on this tick
+    if (command.stepStyle >= OneLeg && command.stepStyle <= ThreeLegs)
+        m_stepStyle = static_cast<StepStyle>(command.stepStyle);
+}
+
+void Platform::publishTelemetry()
+{
+    const StageTiming timing = m_plannerTimer.get();
+    SharedTelemetry telemetry;
+    telemetry.tick = timing.ticks;
+    telemetry.tickUs = timing.lastUs;
+    telemetry.maxTickUs = timing.maxUs;
+    telemetry.rejectedCommands = m_rejectedCommands;
+    telemetry.busyCommandPolls = m_sharedMemory->getBusyCommandPolls();
+    telemetry.commandRecoveries = m_sharedMemory->getCommandRecoveries();
+    telemetry.bodyHeight = m_state.bodyHeight;
+    telemetry.velocityX = m_movementSpeed.x;
+    telemetry.velocityY = m_movementSpeed.y;
+    telemetry.rotation = m_rotationSpeed;
+    telemetry.stepStyle = m_stepStyle;
+    for (int i = 0; i < legsCount; ++i)
+    {
+        SharedLegState &leg = telemetry.legs[i];
+        leg.x = m_state.xPos[i];
+        leg.y = m_state.yPos[i];
+        leg.height = m_state.height[i];
+        leg.legPosition = m_state.phase[i];
+        for (int joint = 0; joint < jointsPerLeg; ++joint)
+            leg.angles[joint] = m_state.jointAngles[m_model->servos[i][joint]];
+    }
+    m_sharedMemory->publish(telemetry);
 }
 
 void Platform::prepareToGo()
@@ -214,10 +638,12 @@ void Platform::prepareToGo()
             m_legs[i].MoveLegToCenter();
             movementDelay();
             m_legs[i].RecalcAngles();
+            outputServos();
             movementDelay();
         }
         m_legs[i].MoveLegDown();
         m_legs[i].RecalcAngles();
+        outputServos();
         movementDelay();
         movementDelay();
     }
@@ -225,10 +651,17 @@ void Platform::prepareToGo()
 
 void Platform::setLegCenter(int idx, float x, float y, float height =0)
 {
+    if (m_active)
+    {
+        ++m_requestedSettings.legVersion[idx];
+        m_requestedSettings.legPosition[idx] = LegCoodinates(x, y, height);
+        publishSettings();
+        return;
+    }
     m_legs[idx].SetLocalXY(x,y);
     if(height>0) m_legs[idx].MoveLegUp();
     m_legs[idx].RecalcAngles();
-
+    outputServos();
 }
 
 std::pair<float, float> Platform::getLegCenter(int idx)
@@ -237,6 +670,31 @@ std::pair<float, float> Platform::getLegCenter(int idx)
     return {coord.x, coord.y};
 }
 
+void Platform::setServoCalibration(const ServoCalibration &calibration)
+{
+    if (!calibration.matches(*m_model))
+        throw std::runtime_error("servo calibration is made for other robot model");
+    m_calibration.writeBuffer() = calibration;
+    m_calibration.publish();
+}
+
+void Platform::outputServos()
+{
+    outputServos(m_state.jointAngles);
+}
+
+void Platform::outputServos(const double *jointAngles)
+{
+    // each output thread converts into its own buffer
+    double servoAngles[servosCount];
+    m_calibration.update();
+    m_calibration.readBuffer().apply(jointAngles, servoAngles);
+    for (int servo = 0; servo < servosCount; ++servo)
+    {
+        m_servoFunction(servo, servoAngles[servo]);
+    }
+}
+
 void Platform::movementThread()
 {
     prepareToGo();
@@ -247,8 +705,71 @@ void Platform::movementThread()
     }
 }
 
+void Platform::plannerThread()
+{
+    prepareToGo();
+    while (m_active)
+    {
+        planStep();
+        FootTargets &targets = m_footTargets.writeBuffer();
+        std::copy(m_state.xPos, m_state.xPos + legsCount, targets.xPos);
+        std::copy(m_state.yPos, m_state.yPos + legsCount, targets.yPos);
+        std::copy(m_state.height, m_state.height + legsCount, targets.height);
+        targets.bodyHeight = m_state.bodyHeight;
+        m_footTargets.publish();
+        movementDelay();
+    }
+}
+
+void Platform::outputThread()
+{
+    // interpolate from where feet are now to the latest planner targets during one planner period
+    const int steps = std::max(1, m_plannerPeriod / std::max(1, m_outputPeriod));
+    FootTargets from = FootTargets();
+    int step = 0;
+    bool started = false;
+    while (m_active)
+    {
+        m_outputTimer.start();
+        if (m_footTargets.update())
+        {
+            const FootTargets &to = m_footTargets.readBuffer();
+            if (started)
+            {
+                std::copy(m_outputState.xPos, m_outputState.xPos + legsCount, from.xPos);
+                std::copy(m_outputState.yPos, m_outputState.yPos + legsCount, from.yPos);
+                std::copy(m_outputState.height, m_outputState.height + legsCount, from.height);
+                from.bodyHeight = m_outputState.bodyHeight;
+            }
+            else
+            {
+                from = to;  // nothing to interpolate from before first targets
+                started = true;
+            }
+            step = 0;
+        }
+        if (started)
+        {
+            const FootTargets &to = m_footTargets.readBuffer();
+            step = std::min(step + 1, steps);
+            const double alpha = static_cast<double>(step) / steps;
+            for (int i = 0; i < legsCount; ++i)
+            {
+                m_outputState.xPos[i] = from.xPos[i] + (to.xPos[i] - from.xPos[i]) * alpha;
+                m_outputState.yPos[i] = from.yPos[i] + (to.yPos[i] - from.yPos[i]) * alpha;
+                m_outputState.height[i] = from.height[i] + (to.height[i] - from.height[i]) * alpha;
+            }
+            m_outputState.bodyHeight = from.bodyHeight + (to.bodyHeight - from.bodyHeight) * alpha;
+            solveLegs(m_outputState, *m_model);
+            outputServos(m_outputState.jointAngles);
+        }
+        m_outputTimer.stop();
+        m_sleepMsFunction(m_outputPeriod);
+    }
+}
+
 void Platform::movementDelay()
 {
-    m_sleepMsFunction(m_kinematicPeriod);
+    m_sleepMsFunction(m_plannerPeriod);
 }
 }
@@ -1,6 +1,15 @@
 #pragma once
 
 #include "Leg.hpp"
+#include "servoCalibration.hpp"
+#include "platformState.hpp"
+#include "legCollision.hpp"
+#include "velocityLimiter.hpp"
+#include "tripleBuffer.hpp"
+#include "stageTiming.hpp"
+#include "sharedMemoryInterface.hpp"
+#include "contactSource.hpp"
+#include "gaitCache.hpp"
 #include <atomic>
 #include <memory>
 #include <thread>
@@ -22,36 +31,203 @@ namespace hexapod
 
         Platform(std::function<void(int)> sleepFuction,
                  std::function<void(int, double)> servoPositionFunction,
-                 int kinematic_period=100);
-        /*Move legs into transportable position*/
+                 int kinematic_period=100,
+                 std::shared_ptr<const KinematicModel> model = KinematicModel::getDefault());
+        ~Platform();
+        /*Move legs into transportable position, movement threads are stopped first*/
         void parkLegs();        
+        /*!
+         * \brief setVelocity, setWalkingStyle, setBodyHeight, setLegCenter, setCollisionCheck,
+         *        setVelocityLimiter, setContactSource - while movement threads run the change is handed
+         *        to the planner and applied on its next tick. Call them from one thread at a time
+         */
         void setVelocity(const vec2f movementSpeed, const double rotationSpeed);
         void setWalkingStyle(StepStyle style);
         void setBodyHeight(const float height);
         float getBodyHeight() const;
         void startMovementThread();
+        /*!
+         * \brief startMultiRateThreads - run gait planner and IK/output in separate threads.
+         *        Planner makes feet targets every plannerPeriod ms, output stage interpolates
+         *        them and drives servos every outputPeriod ms
+         */
+        void startMultiRateThreads(int plannerPeriod, int outputPeriod);
         void stopMovementThread();
+        StageTiming getPlannerTiming() const;
+        StageTiming getOutputTiming() const;
+        // threads must be stopped
         void prepareToGo();
         void setLegCenter(int idx, float x, float y, float height);
+        // threads must be stopped
         std::pair<float,float> getLegCenter(int idx);
+        /*!
+         * \brief setServoCalibration - replace per-servo trims, applied on next output. Calibration must be
+         *        made with model of this platform (same servo ids, directions, attachment), throws otherwise.
+         *        Output thread picks it up without locks, call it from one thread at a time
+         */
+        void setServoCalibration(const ServoCalibration &calibration);
+        /*!
+         * \brief setCollisionCheck - check neighbor legs on every tick. If legs touch, movement of legs
+         *        on the ground is vetoed for this tick and one of touching legs makes a step to its center
+         */
+        void setCollisionCheck(bool enabled, double femurRadius = 15, double tibiaRadius = 10);
+        struct CollisionStats
+        {
+            unsigned long long checks;
+            unsigned long long vetoes;     // ticks when body movement was cancelled
+            unsigned long long unresolved; // ticks when legs still touched after veto
+        };
+        CollisionStats getCollisionStats() const;
+        /*!
+         * \brief setVelocityLimiter - scale commanded velocity on every tick so that
+         *        servos of legs on the ground can follow, see VelocityLimiter. Limiter moves feet with
+         *        geometry of this platform
+         */
+        void setVelocityLimiter(const VelocityLimiter &limiter, bool enabled = true);
+        VelocityLimiter::Report getVelocityLimiterReport() const;
+        /*!
+         * \brief attachSharedMemory - create POSIX shared memory object with given name, publish
+         *        telemetry there on every tick and take commands from other processes, see SharedMemoryClient.
+         *        Call it and detachSharedMemory() only while movement threads are stopped
+         */
+        void attachSharedMemory(const std::string &name);
+        void detachSharedMemory();
+        /*!
+         * \brief setContactSource - end swings on foot contact instead of fixed two ticks.
+         *        Foot is carried over its target on first tick and then lowered by stepHeight/descentSteps
+         *        every tick until it touches or reaches ground level, next legs are raised on the same tick.
+         *        Flat floor step takes 1 + descentSteps ticks (3 with fixed swings). nullptr returns fixed swings
+         */
+        void setContactSource(std::shared_ptr<ContactSource> source, int descentSteps = 1);
+        /*!
+         * \brief enableGaitCache - play back recorded gait cycles of steady commands instead of
+         *        planning them again, see GaitCache. 0 bytes disables it. Not used with contact source.
+         *        Played ticks do not run planner, so getCollisionStats(), getVelocityLimiterReport() and
+         *        getIkFailures() stay frozen during playback.
+         *        Call it only while movement threads are stopped
+         */
+        void enableGaitCache(size_t budgetBytes);
+        GaitCache::Stats getGaitCacheStats() const;
+        /*!
+         * \brief getIkFailures - planned feet positions legs could not reach since start
+         */
+        unsigned long long getIkFailures() const;
+        /*!
+         * \brief getRejectedCommands - shared memory commands ignored for non-finite values or body height <= 0
+         */
+        unsigned long long getRejectedCommands() const;
+        /*!
+         * \brief getState - state of the planner, for diagnostics when threads are stopped
+         *        or from the planner thread. Stats getters above are safe while threads run,
+         *        they return a copy published by the planner after every tick
+         */
+        const PlatformState &getState() const;
         void procedureGo();
     private:
         void movementThread();
+        void plannerThread();
+        void outputThread();
+        // gait and feet positions for one tick, servos are not touched
+        void planStep();
+        void planGait();
         void movingEnd();
         void movementDelay();
         int getLegToRaise();
         void raiseOneLeg(int legToRaise);
         void raiseTwoLegs(int legToRaise);
         void raiseThreeLegs(int legToRaise);
+        // move legs on the ground, limited by servo speeds if limiter is enabled
+        void moveGroundedLegsLimited(const PlatformState &previous);
+        // veto or adjust this tick if legs touch each other
+        void resolveCollisions(const PlatformState &previous);
+        // shared memory exchange with other processes, called from planner
+        void applySharedCommand();
+        void publishTelemetry();
+        // take settings changed by user while threads run, called from planner
+        void applyPendingSettings();
+        void publishSettings();
+        // copy of stats for getters, written by planner after every tick
+        void publishDiagnostics();
+        // stored gait cycles are wrong after settings change
+        void clearGaitCache();
+        // convert joint angles of all legs to servo angles and send them
+        void outputServos();
+        void outputServos(const double *jointAngles);
     private:
+        // hot per-tick data first, legs are views on it
+        PlatformState m_state;
         std::vector<Leg> m_legs;
-        double m_bodyHeight;
+        std::shared_ptr<const KinematicModel> m_model;
+        bodyConfiguration::HexapodMovementConfiguration m_movementConfiguration;
         double m_rotationSpeed;
         vec2f m_movementSpeed;
         std::function<void(int)> m_sleepMsFunction;
+        std::function<void(int, double)> m_servoFunction;
+        // written by user thread, read by whatever thread sends servos
+        TripleBuffer<ServoCalibration> m_calibration;
+        LegCollision m_collision;
+        bool m_collisionCheck;
+        CollisionStats m_collisionStats;
+        VelocityLimiter m_velocityLimiter;
+        bool m_velocityLimit;
+        std::unique_ptr<SharedMemoryServer> m_sharedMemory;
+        std::shared_ptr<ContactSource> m_contactSource;
+        int m_descentSteps;
+        std::unique_ptr<GaitCache> m_gaitCache;
+        unsigned long long m_ikFailures;
+        unsigned long long m_rejectedCommands;
+        struct Diagnostics
+        {
+            unsigned long long ikFailures;
+            unsigned long long rejectedCommands;
+            CollisionStats collisionStats;
+            VelocityLimiter::Report velocityLimiterReport;
+            GaitCache::Stats gaitCacheStats;
+        };
+        Seqlock<Diagnostics> m_diagnostics;
         std::atomic_bool m_active;
+        // settings from user thread while threads run, every part has a counter of changes,
+        // so planner applies only parts changed since last time
+        struct Settings
+        {
+            unsigned velocityVersion;
+            vec2f movementSpeed;
+            double rotationSpeed;
+            unsigned stepStyleVersion;
+            StepStyle stepStyle;
+            unsigned bodyHeightVersion;
+            double bodyHeight;
+            unsigned legVersion[legsCount];
+            LegCoodinates legPosition[legsCount];
+            unsigned collisionVersion;
+            bool collisionCheck;
+            double femurRadius;
+            double tibiaRadius;
+            unsigned velocityLimiterVersion;
+            VelocityLimiter velocityLimiter;
+            bool velocityLimit;
+            unsigned contactVersion;
+            std::shared_ptr<ContactSource> contactSource;
+            int descentSteps;
+        };
+        Settings m_requestedSettings;  // user thread side
+        Settings m_appliedSettings;    // planner side
+        TripleBuffer<Settings> m_settings;
+        std::atomic<double> m_publishedBodyHeight;
         StepStyle m_stepStyle;
         int m_kinematicPeriod;
+        // period of running planner ticks: m_kinematicPeriod or planner period of multi-rate mode
+        int m_plannerPeriod;
+        // multi-rate mode: planner -> m_footTargets -> IK/output stage with its own state,
+        // planner works with m_plannerPeriod
+        int m_outputPeriod;
+        TripleBuffer<FootTargets> m_footTargets;
+        PlatformState m_outputState;
+        StageTimer m_plannerTimer;
+        StageTimer m_outputTimer;
+        std::thread m_movementThread;
+        std::thread m_plannerThread;
+        std::thread m_outputThread;
     };
 } //namespace hexaod
 
@@ -0,0 +1,85 @@
+#include "platformState.hpp"
+#include "fastMath.hpp"
+#include <cmath>
+
+namespace hexapod
+{
+namespace
+{
+    const unsigned char onGround = 0; // Leg::on_ground
+}
+
+void moveGroundedLegs(PlatformState &state, const KinematicModel &model,
+                      double xoffset, double yoffset, double rotation)
+{
+    // rotation is the same for all legs, calculate it once
+    double sinA, cosA;
+    math::sincos(rotation * math::degToRad, sinA, cosA);
+    for (int i = 0; i < legsCount; ++i)
+    {
+        double x = state.xPos[i] - xoffset;
+        double y = state.yPos[i] + model.side[i] * yoffset;
+        // rotate around body center in global coordinates
+        double globalX = x + model.mountX[i];
+        double globalY = model.side[i] * (y + model.mountY[i]);
+        double rotatedX = (cosA * globalX) - (sinA * globalY);
+        double rotatedY = (sinA * globalX) + (cosA * globalY);
+        x = rotatedX - model.mountX[i];
+        y = model.side[i] * rotatedY - model.mountY[i];
+
+        bool grounded = state.phase[i] == onGround;
+        state.xPos[i] = grounded ? x : state.xPos[i];
+        state.yPos[i] = grounded ? y : state.yPos[i];
+    }
+}
+
+int solveLegs(PlatformState &state, const KinematicModel &model, unsigned *failedLegs)
+{
+    double ratio[legsCount];
+    double L[legsCount];
+    double LSq[legsCount];
+    // arguments of acos for angle A (two parts) and angle B
+    double acosIn[3 * legsCount];
+    double acosOut[3 * legsCount];
+    // failed legs keep whole old pose, so angle C is not written directly
+    double angleC[legsCount];
+    for (int i = 0; i < legsCount; ++i)
+    {
+        if (state.yPos[i] == 0.0)
+            state.yPos[i] = 0.01;
+        ratio[i] = state.xPos[i] / state.yPos[i];
+        double L1 = std::sqrt(state.xPos[i] * state.xPos[i] + state.yPos[i] * state.yPos[i]);
+        double horizontal = L1 - model.cLegPart;
+        LSq[i] = state.bodyHeight * state.bodyHeight + horizontal * horizontal;
+        L[i] = std::sqrt(LSq[i]);
+        acosIn[i] = (state.bodyHeight - state.height[i]) / L[i];
+        acosIn[legsCount + i] = (model.aSqMinusBSq - LSq[i]) / (model.minusTwoB * L[i]);
+        acosIn[2 * legsCount + i] = (LSq[i] - model.aSqPlusBSq) / model.minusTwoAB;
+    }
+    math::atan(ratio, angleC, legsCount);
+    math::acos(acosIn, acosOut, 3 * legsCount);
+
+    int failures = 0;
+    unsigned failed = 0;
+    for (int i = 0; i < legsCount; ++i)
+    {
+        double angleA = acosOut[i] + acosOut[legsCount + i];
+        double angleB = acosOut[2 * legsCount + i];
+        if (L[i] > model.maxReach || !std::isfinite(angleA) || !std::isfinite(angleB) || !std::isfinite(angleC[i]))
+        {
+            ++failures;
+            failed |= 1u << i;
+            continue;
+        }
+        state.angleA[i] = angleA * math::radToDeg;
+        state.angleB[i] = angleB * math::radToDeg;
+        state.angleC[i] = angleC[i] * math::radToDeg;
+        state.jointAngles[model.servos[i][0]] = state.angleA[i];
+        state.jointAngles[model.servos[i][1]] = state.angleB[i];
+        state.jointAngles[model.servos[i][2]] = state.angleC[i];
+    }
+    if (failedLegs)
+        *failedLegs = failed;
+    return failures;
+}
+}
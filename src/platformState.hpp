@@ -0,0 +1,61 @@
+#pragma once
+
+#include "robotDescription.hpp"
+
+namespace hexapod
+{
+    const int cacheLineSize = 64;
+
+    /*!
+     * \brief PlatformState - everything that changes on every tick, for all legs at once.
+     *        Structure of arrays indexed by leg number, Leg objects are only views on it.
+     *        Data used together on a tick is kept in the same cache lines
+     */
+    struct alignas(cacheLineSize) PlatformState
+    {
+        // feet positions in leg local coordinates, X - front, Y - away from body
+        alignas(cacheLineSize) double xPos[legsCount];
+        double yPos[legsCount];
+        double height[legsCount];       // distance from ground
+        unsigned char phase[legsCount]; // Leg::LegPosition
+        // where leg in air goes
+        alignas(cacheLineSize) double targetX[legsCount];
+        double targetY[legsCount];
+        double xCenter[legsCount];
+        double yCenter[legsCount];
+        // inverse kinematics output in degrees
+        alignas(cacheLineSize) double angleA[legsCount];
+        double angleB[legsCount];
+        double angleC[legsCount];
+        // joint angles of the whole frame indexed by servo id
+        alignas(cacheLineSize) double jointAngles[servosCount];
+        double bodyHeight;
+    };
+
+    /*!
+     * \brief FootTargets - feet positions produced by gait planner, input of IK/output stage
+     */
+    struct FootTargets
+    {
+        double xPos[legsCount];
+        double yPos[legsCount];
+        double height[legsCount];
+        double bodyHeight;
+    };
+
+    /*!
+     * \brief moveGroundedLegs - move all legs standing on the ground by body offset and rotation.
+     *        Same as Leg::LegAddOffsetInGlobal + Leg::TurnLegWithGlobalCoord for every leg,
+     *        but in one loop without branches
+     */
+    void moveGroundedLegs(PlatformState &state, const KinematicModel &model,
+                          double xoffset, double yoffset, double rotation);
+
+    /*!
+     * \brief solveLegs - Leg::RecalcAngles for all legs, trigonometry is done by batch math functions.
+     *        Legs that can not reach their feet keep all old joint angles, A, B and C
+     * \param failedLegs - if given, gets bit for every such leg
+     * \return number of such legs
+     */
+    int solveLegs(PlatformState &state, const KinematicModel &model, unsigned *failedLegs = nullptr);
+}
@@ -0,0 +1,184 @@
+#include "robotDescription.hpp"
+#include "configFile.hpp"
+#include <cmath>
+#include <stdexcept>
+
+namespace hexapod
+{
+namespace
+{
+void fillLeg(LegDescription &leg, int firstServo, int side,
+             double mountX, double mountY, double centerX, double centerY)
+{
+    leg.mountX = mountX;
+    leg.mountY = mountY;
+    leg.side = side;
+    leg.centerX = centerX;
+    leg.centerY = centerY;
+    // it means leg look left of right when in math it`s degree is 0 but in real it`s servo 90
+    leg.attachmentAngle = -90;
+    for (int joint = 0; joint < jointsPerLeg; ++joint)
+    {
+        leg.servos[joint] = firstServo + joint;
+        // left motors moves mirrored to right
+        leg.directions[joint] = side;
+    }
+}
+}
+
+RobotDescription RobotDescription::getDefault()
+{
+    const bodyConfiguration::HexapodFrame frame = bodyConfiguration::HexapodFrame::getConfiguredFrame();
+    RobotDescription description;
+    description.cLegPart = frame.cLegPart;
+    description.bLegPart = frame.bLegPart;
+    description.aLegPart = frame.aLegPart;
+    description.bodyHeight = 50;
+    //X - front, Y - left(or right)
+    fillLeg(description.legs[0], 0, 1, frame.rearXOffset, frame.rearYOffset, 70, 70);    // RightFront
+    fillLeg(description.legs[1], 3, 1, 0, frame.centerYOffset, 0, 100);                 // RightMiddle
+    fillLeg(description.legs[2], 6, 1, -frame.rearXOffset, frame.rearYOffset, -70, 70);  // RightBack
+    fillLeg(description.legs[3], 9, -1, -frame.rearXOffset, frame.rearYOffset, -70, 70); // LeftBack
+    fillLeg(description.legs[4], 12, -1, 0, frame.centerYOffset, 0, 100);               // LeftMiddle
+    fillLeg(description.legs[5], 15, -1, frame.rearXOffset, frame.rearYOffset, 70, 70);  // LeftFront
+    return description;
+}
+
+RobotDescription RobotDescription::loadFromFile(const std::string &fileName)
+{
+    RobotDescription description = getDefault();
+    ConfigFile::parse(fileName, [&description](const std::string &key, ConfigFile &entry)
+    {
+        int idx = 0;
+        std::string field;
+        if (key == "frame.c")
+            entry.read(&description.cLegPart, 1);
+        else if (key == "frame.b")
+            entry.read(&description.bLegPart, 1);
+        else if (key == "frame.a")
+            entry.read(&description.aLegPart, 1);
+        else if (key == "body.height")
+            entry.read(&description.bodyHeight, 1);
+        else if (ConfigFile::splitIndexedKey(key, "leg.", idx, field))
+        {
+            if (idx >= legsCount)
+                throw entry.error("wrong leg number in " + key);
+            LegDescription &leg = description.legs[idx];
+            if (field == "mount")
+            {
+                double mount[2];
+                entry.read(mount, 2);
+                leg.mountX = mount[0];
+                leg.mountY = mount[1];
+            }
+            else if (field == "center")
+            {
+                double center[2];
+                entry.read(center, 2);
+                leg.centerX = center[0];
+                leg.centerY = center[1];
+            }
+            else if (field == "side")
+            {
+                std::string side;
+                entry.read(&side, 1);
+                if (side == "right")
+                    leg.side = 1;
+                else if (side == "left")
+                    leg.side = -1;
+                else
+                    throw entry.error("side must be right or left");
+            }
+            else if (field == "attachment")
+                entry.read(&leg.attachmentAngle, 1);
+            else if (field == "servos")
+                entry.read(leg.servos, jointsPerLeg);
+            else if (field == "directions")
+                entry.read(leg.directions, jointsPerLeg);
+            else
+                throw entry.error("unknown key " + key);
+        }
+        else
+            throw entry.error("unknown key " + key);
+    });
+    description.validate();
+    return description;
+}
+
+void RobotDescription::validate() const
+{
+    // comparisons below are false for NaN, so not finite values are rejected first
+    if (!std::isfinite(cLegPart) || !std::isfinite(bLegPart) || !std::isfinite(aLegPart))
+        throw std::runtime_error("leg parts length must be finite");
+    if (!(cLegPart > 0 && bLegPart > 0 && aLegPart > 0))
+        throw std::runtime_error("leg parts length must be positive");
+    if (!std::isfinite(bodyHeight) || !(bodyHeight > 0))
+        throw std::runtime_error("body height must be positive");
+
+    bool servoUsed[servosCount] = {};
+    for (int i = 0; i < legsCount; ++i)
+    {
+        const LegDescription &leg = legs[i];
+        const std::string name = "leg " + std::to_string(i) + ": ";
+        if (leg.side != 1 && leg.side != -1)
+            throw std::runtime_error(name + "side must be 1 or -1");
+        if (!std::isfinite(leg.mountX) || !std::isfinite(leg.mountY) || !std::isfinite(leg.centerX)
+            || !std::isfinite(leg.centerY) || !std::isfinite(leg.attachmentAngle))
+            throw std::runtime_error(name + "mount, center and attachment must be finite");
+        for (int joint = 0; joint < jointsPerLeg; ++joint)
+        {
+            int servo = leg.servos[joint];
+            if (servo < 0 || servo >= servosCount)
+                throw std::runtime_error(name + "servo id out of range");
+            if (servoUsed[servo])
+                throw std::runtime_error(name + "servo id " + std::to_string(servo) + " used twice");
+            servoUsed[servo] = true;
+            if (leg.directions[joint] != 1 && leg.directions[joint] != -1)
+                throw std::runtime_error(name + "servo direction must be 1 or -1");
+        }
+        // center must be solvable by RecalcAngles on nominal body height
+        double L1 = std::sqrt(leg.centerX * leg.centerX + leg.centerY * leg.centerY);
+        double L = std::sqrt(bodyHeight * bodyHeight + (L1 - cLegPart) * (L1 - cLegPart));
+        if (L > aLegPart + bLegPart || L < std::fabs(aLegPart - bLegPart))
+            throw std::runtime_error(name + "center is not reachable on body height");
+    }
+}
+
+std::shared_ptr<const KinematicModel> KinematicModel::compile(const RobotDescription &description)
+{
+    description.validate();
+    std::shared_ptr<KinematicModel> model = std::make_shared<KinematicModel>();
+    model->cLegPart = description.cLegPart;
+    model->bLegPart = description.bLegPart;
+    model->aLegPart = description.aLegPart;
+    model->bodyHeight = description.bodyHeight;
+    model->maxReach = description.aLegPart + description.bLegPart;
+    model->aSqMinusBSq = description.aLegPart * description.aLegPart - description.bLegPart * description.bLegPart;
+    model->aSqPlusBSq = description.aLegPart * description.aLegPart + description.bLegPart * description.bLegPart;
+    model->minusTwoAB = -2 * description.aLegPart * description.bLegPart;
+    model->minusTwoB = -2 * description.bLegPart;
+    for (int i = 0; i < legsCount; ++i)
+    {
+        const LegDescription &leg = description.legs[i];
+        model->mountX[i] = leg.mountX;
+        model->mountY[i] = leg.mountY;
+        model->side[i] = leg.side;
+        model->centerX[i] = leg.centerX;
+        model->centerY[i] = leg.centerY;
+        model->attachmentAngle[i] = leg.attachmentAngle;
+        model->directionInGlobal[i] = -90 * leg.side;
+        for (int joint = 0; joint < jointsPerLeg; ++joint)
+        {
+            model->servos[i][joint] = leg.servos[joint];
+            model->directions[i][joint] = leg.directions[joint];
+        }
+    }
+    return model;
+}
+
+std::shared_ptr<const KinematicModel> KinematicModel::getDefault()
+{
+    static const std::shared_ptr<const KinematicModel> model = compile(RobotDescription::getDefault());
+    return model;
+}
+}
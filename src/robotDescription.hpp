@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "bodyConfiguration.hpp"
+
+namespace hexapod
+{
+    const int legsCount = 6;
+    const int jointsPerLeg = 3;
+    const int servosCount = legsCount * jointsPerLeg;
+
+    /*!
+     * \brief LegDescription - how one leg is attached to the body and wired to servos.
+     *        Local leg coordinates: X looks front, Y looks away from the body.
+     */
+    struct LegDescription
+    {
+        double mountX;          // attachment point along body X axis
+        double mountY;          // distance from body axis to attachment point
+        int side;               // 1 for right legs, -1 for left legs (mirrors local Y)
+        double centerX;         // neutral foot position in local coordinates
+        double centerY;
+        double attachmentAngle; // coxa angle in math zero, servo sees angle - attachmentAngle
+        int servos[jointsPerLeg];     // servo ids for joints A, B, C
+        int directions[jointsPerLeg]; // 1 or -1 (servo mounted mirrored)
+    };
+
+    /*!
+     * \brief RobotDescription - full geometry of one hardware revision.
+     *        Can be loaded from a text file, see loadFromFile()
+     */
+    struct RobotDescription
+    {
+        double cLegPart;  // BODY * - C - * - B - * - A - END
+        double bLegPart;
+        double aLegPart;
+        double bodyHeight; // nominal body height, legs centers must be reachable on it
+        LegDescription legs[legsCount];
+
+        /*!
+         * \brief getDefault - description of the original robot (see doc/body.png)
+         */
+        static RobotDescription getDefault();
+        /*!
+         * \brief loadFromFile - parse "key = values" description file.
+         *        Every key is optional, missing ones keep default values:
+         *          frame.c = 53            frame.b = 81         frame.a = 120
+         *          body.height = 50
+         *          leg.<i>.mount = x y     leg.<i>.side = right|left
+         *          leg.<i>.center = x y    leg.<i>.attachment = -90
+         *          leg.<i>.servos = a b c  leg.<i>.directions = 1 1 -1
+         *        Lines starting with '#' are comments.
+         *        Throws std::runtime_error on syntax or validation error.
+         */
+        static RobotDescription loadFromFile(const std::string &fileName);
+        /*!
+         * \brief validate - throws std::runtime_error if description is not physically possible
+         */
+        void validate() const;
+    };
+
+    /*!
+     * \brief KinematicModel - description compiled into flat arrays with derived constants.
+     *        Created once and shared by all legs of a platform
+     */
+    struct KinematicModel
+    {
+        static std::shared_ptr<const KinematicModel> compile(const RobotDescription &description);
+        static std::shared_ptr<const KinematicModel> getDefault();
+
+        double cLegPart;
+        double bLegPart;
+        double aLegPart;
+        double bodyHeight;
+        // derived constants for RecalcAngles
+        double maxReach;            // a + b
+        double aSqMinusBSq;         // a^2 - b^2
+        double aSqPlusBSq;          // a^2 + b^2
+        double minusTwoAB;          // -2 * a * b
+        double minusTwoB;           // -2 * b
+
+        // per leg data, index is a leg number
+        double mountX[legsCount];
+        double mountY[legsCount];
+        double side[legsCount];
+        double centerX[legsCount];
+        double centerY[legsCount];
+        double attachmentAngle[legsCount];
+        double directionInGlobal[legsCount]; // -90 for right legs, 90 for left
+        int servos[legsCount][jointsPerLeg];
+        int directions[legsCount][jointsPerLeg];
+    };
+}
@@ -0,0 +1,181 @@
+#include "servoCalibration.hpp"
+#include "configFile.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace hexapod
+{
+namespace
+{
+double interpolate(const std::vector<std::pair<double, double>> &table, double angle)
+{
+    if (angle <= table.front().first)
+        return table.front().second;
+    for (size_t i = 1; i < table.size(); ++i)
+    {
+        if (angle <= table[i].first)
+        {
+            const std::pair<double, double> &from = table[i - 1];
+            const std::pair<double, double> &to = table[i];
+            return from.second + (angle - from.first) * (to.second - from.second) / (to.first - from.first);
+        }
+    }
+    return table.back().second;
+}
+}
+
+ServoCalibration::ServoCalibration(std::shared_ptr<const KinematicModel> model)
+    : m_model(model)
+{
+    for (int leg = 0; leg < legsCount; ++leg)
+    {
+        const int *servos = m_model->servos[leg];
+        // joint A goes as is
+        m_geometryBias[servos[0]] = 0;
+        m_geometryScale[servos[0]] = 1;
+        // joint B is mounted upside down
+        m_geometryBias[servos[1]] = 180;
+        m_geometryScale[servos[1]] = -1;
+        // joint C looks left or right when in math it`s degree is 0
+        m_geometryBias[servos[2]] = -m_model->attachmentAngle[leg];
+        m_geometryScale[servos[2]] = 1;
+        for (int joint = 0; joint < jointsPerLeg; ++joint)
+            m_entries[servos[joint]].direction = m_model->directions[leg][joint];
+    }
+    for (int servo = 0; servo < servosCount; ++servo)
+        compile(servo);
+}
+
+ServoCalibration ServoCalibration::loadFromFile(const std::string &fileName,
+                                                std::shared_ptr<const KinematicModel> model)
+{
+    ServoCalibration calibration(model);
+    ConfigFile::parse(fileName, [&calibration](const std::string &key, ConfigFile &entry)
+    {
+        int servo = 0;
+        std::string field;
+        if (!ConfigFile::splitIndexedKey(key, "servo.", servo, field))
+            throw entry.error("unknown key " + key);
+        if (servo >= servosCount)
+            throw entry.error("wrong servo number in " + key);
+        ServoCalibrationEntry trim = calibration.getEntry(servo);
+        if (field == "offset")
+            entry.read(&trim.offset, 1);
+        else if (field == "gain")
+            entry.read(&trim.gain, 1);
+        else if (field == "direction")
+            entry.read(&trim.direction, 1);
+        else if (field == "range")
+        {
+            double range[2];
+            entry.read(range, 2);
+            trim.minAngle = range[0];
+            trim.maxAngle = range[1];
+        }
+        else if (field == "correction")
+        {
+            std::vector<double> points;
+            entry.readAll<double>(points);
+            if (points.size() % 2 != 0)
+                throw entry.error("correction needs pairs of angles");
+            trim.correction.clear();
+            for (size_t i = 0; i < points.size(); i += 2)
+                trim.correction.emplace_back(points[i], points[i + 1]);
+        }
+        else
+            throw entry.error("unknown key " + key);
+        try
+        {
+            calibration.setEntry(servo, trim);
+        }
+        catch (std::runtime_error &e)
+        {
+            throw entry.error(e.what());
+        }
+    });
+    return calibration;
+}
+
+void ServoCalibration::validate(int servo, const ServoCalibrationEntry &entry)
+{
+    const std::string name = "servo " + std::to_string(servo) + ": ";
+    if (!std::isfinite(entry.offset) || !std::isfinite(entry.gain) || entry.gain == 0)
+        throw std::runtime_error(name + "offset and gain must be finite, gain not zero");
+    if (entry.direction != 1 && entry.direction != -1)
+        throw std::runtime_error(name + "direction must be 1 or -1");
+    if (!(entry.minAngle <= entry.maxAngle))
+        throw std::runtime_error(name + "wrong range");
+    if (entry.correction.size() == 1)
+        throw std::runtime_error(name + "correction needs at least 2 points");
+    for (size_t i = 1; i < entry.correction.size(); ++i)
+    {
+        if (!(entry.correction[i].first > entry.correction[i - 1].first))
+            throw std::runtime_error(name + "correction points must be sorted");
+    }
+}
+
+void ServoCalibration::setEntry(int servo, const ServoCalibrationEntry &entry)
+{
+    if (servo < 0 || servo >= servosCount)
+        throw std::runtime_error("wrong servo number");
+    validate(servo, entry);
+    m_entries[servo] = entry;
+    compile(servo);
+}
+
+const ServoCalibrationEntry &ServoCalibration::getEntry(int servo) const
+{
+    if (servo < 0 || servo >= servosCount)
+        throw std::runtime_error("wrong servo number");
+    return m_entries[servo];
+}
+
+void ServoCalibration::compile(int servo)
+{
+    const ServoCalibrationEntry &entry = m_entries[servo];
+    double bias = entry.offset + entry.gain * m_geometryBias[servo];
+    double scale = entry.gain * m_geometryScale[servo];
+    if (entry.direction < 0)
+    {
+        // 180 - (bias + scale * angle)
+        bias = 180 - bias;
+        scale = -scale;
+    }
+    m_bias[servo] = bias;
+    m_scale[servo] = scale;
+    m_min[servo] = entry.minAngle;
+    m_max[servo] = entry.maxAngle;
+
+    m_corrected.erase(std::remove(m_corrected.begin(), m_corrected.end(), servo), m_corrected.end());
+    if (!entry.correction.empty())
+        m_corrected.push_back(servo);
+}
+
+void ServoCalibration::apply(const double *jointAngles, double *servoAngles) const
+{
+    // no branches here, compiler can vectorize it
+    for (int i = 0; i < servosCount; ++i)
+        servoAngles[i] = m_bias[i] + m_scale[i] * jointAngles[i];
+    for (int servo : m_corrected)
+        servoAngles[servo] = interpolate(m_entries[servo].correction, servoAngles[servo]);
+    for (int i = 0; i < servosCount; ++i)
+        servoAngles[i] = std::min(std::max(servoAngles[i], m_min[i]), m_max[i]);
+}
+
+bool ServoCalibration::matches(const KinematicModel &model) const
+{
+    for (int leg = 0; leg < legsCount; ++leg)
+    {
+        if (model.attachmentAngle[leg] != m_model->attachmentAngle[leg])
+            return false;
+        for (int joint = 0; joint < jointsPerLeg; ++joint)
+        {
+            if (model.servos[leg][joint] != m_model->servos[leg][joint]
+                || model.directions[leg][joint] != m_model->directions[leg][joint])
+                return false;
+        }
+    }
+    return true;
+}
+}
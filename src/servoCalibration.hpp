@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "robotDescription.hpp"
+
+namespace hexapod
+{
+    /*!
+     * \brief ServoCalibrationEntry - trim of one servo.
+     *        servo = clamp(correction(offset + gain * angle), minAngle, maxAngle),
+     *        direction -1 mirrors the angle (180 - angle) before correction
+     */
+    struct ServoCalibrationEntry
+    {
+        ServoCalibrationEntry()
+            : offset(0), gain(1), direction(1), minAngle(0), maxAngle(180)
+        {
+        }
+        double offset;
+        double gain;
+        int direction;
+        double minAngle;
+        double maxAngle;
+        // optional piecewise-linear correction, pairs of (commanded, corrected) sorted by commanded angle
+        std::vector<std::pair<double, double>> correction;
+    };
+
+    /*!
+     * \brief ServoCalibration - maps joint angles from inverse kinematics to servo angles.
+     *        Leg attachment (joint B flip, coxa offset) from the kinematic model and per-servo trim
+     *        are compiled into one linear stage, so whole frame is converted in one pass
+     */
+    class ServoCalibration
+    {
+    public:
+        explicit ServoCalibration(std::shared_ptr<const KinematicModel> model = KinematicModel::getDefault());
+        /*!
+         * \brief loadFromFile - read servo trims, keys are:
+         *          servo.<id>.offset = 1.5      servo.<id>.gain = 1.02
+         *          servo.<id>.direction = -1    servo.<id>.range = 5 175
+         *          servo.<id>.correction = 0 0  90 93  180 178
+         *        Servos not mentioned keep values from the kinematic model.
+         *        Throws std::runtime_error on syntax or validation error
+         */
+        static ServoCalibration loadFromFile(const std::string &fileName,
+                                             std::shared_ptr<const KinematicModel> model = KinematicModel::getDefault());
+        void setEntry(int servo, const ServoCalibrationEntry &entry);
+        const ServoCalibrationEntry &getEntry(int servo) const;
+        /*!
+         * \brief apply - convert frame of joint angles (degrees, indexed by servo id) to servo angles
+         */
+        void apply(const double *jointAngles, double *servoAngles) const;
+        /*!
+         * \brief matches - true if servo ids, directions and coxa attachment of the model are the ones
+         *        calibration was made with, so it maps joints of that robot correctly
+         */
+        bool matches(const KinematicModel &model) const;
+
+    private:
+        void compile(int servo);
+        static void validate(int servo, const ServoCalibrationEntry &entry);
+
+        std::shared_ptr<const KinematicModel> m_model;
+        ServoCalibrationEntry m_entries[servosCount];
+        // leg attachment part of the mapping, from the kinematic model
+        double m_geometryBias[servosCount];
+        double m_geometryScale[servosCount];
+        // compiled linear stage: bias + scale * angle
+        double m_bias[servosCount];
+        double m_scale[servosCount];
+        double m_min[servosCount];
+        double m_max[servosCount];
+        std::vector<int> m_corrected; // servos having correction table
+    };
+}
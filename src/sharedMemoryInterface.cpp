@@ -0,0 +1,189 @@
+#include "sharedMemoryInterface.hpp"
+#include <cerrno>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hexapod
+{
+namespace
+{
+const std::uint32_t regionMagic = 0x48455841; // "HEXA"
+const std::uint32_t regionVersion = 3;
+
+std::runtime_error systemError(const std::string &what, const std::string &name)
+{
+    return std::runtime_error(what + " " + name + ": " + std::strerror(errno));
+}
+
+SharedRegion *mapRegion(int fd, const std::string &name)
+{
+    void *address = mmap(nullptr, sizeof(SharedRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        std::runtime_error error = systemError("can not map shared memory", name);
+        close(fd);
+        throw error;
+    }
+    // mapping stays valid without descriptor
+    close(fd);
+    return static_cast<SharedRegion *>(address);
+}
+}
+
+SharedMemoryServer::SharedMemoryServer(const std::string &name)
+    : m_name(name)
+    , m_region(nullptr)
+    , m_lastCommand()
+    , m_busyCommandPolls(0)
+    , m_commandRecoveries(0)
+{
+    // existing object is never taken silently, it may belong to a running platform
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0 && errno == EEXIST)
+    {
+        fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+            throw systemError("can not open existing shared memory", name);
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size != static_cast<off_t>(sizeof(SharedRegion)))
+        {
+            close(fd);
+            throw std::runtime_error("shared memory " + name + " already exists and is not created by platform");
+        }
+        m_region = mapRegion(fd, name);
+        if (!takeOverStaleRegion())
+        {
+            munmap(m_region, sizeof(SharedRegion));
+            throw std::runtime_error("shared memory " + name + " is used by other process");
+        }
+        return;
+    }
+    if (fd < 0)
+        throw systemError("can not create shared memory", name);
+    if (ftruncate(fd, sizeof(SharedRegion)) != 0)
+    {
+        std::runtime_error error = systemError("can not resize shared memory", name);
+        close(fd);
+        shm_unlink(name.c_str());
+        throw error;
+    }
+    try
+    {
+        m_region = mapRegion(fd, name);
+    }
+    catch (...)
+    {
+        shm_unlink(name.c_str());
+        throw;
+    }
+    // new object is zero filled, that is a valid empty seqlock
+    new (m_region) SharedRegion();
+    m_region->version = regionVersion;
+    m_region->serverPid.store(getpid(), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_region->magic = regionMagic;
+}
+
+bool SharedMemoryServer::takeOverStaleRegion()
+{
+    if (m_region->magic != regionMagic || m_region->version != regionVersion)
+        return false;
+    std::int32_t owner = m_region->serverPid.load(std::memory_order_relaxed);
+    if (owner == getpid() || kill(owner, 0) == 0 || errno != ESRCH)
+        return false;
+    // only one of platforms started at once gets it
+    if (!m_region->serverPid.compare_exchange_strong(owner, getpid()))
+        return false;
+    // clients may still use the object, seqlocks are kept, last command of dead platform is not applied
+    m_lastCommand.id = m_region->lastCommandId.load(std::memory_order_relaxed);
+    return true;
+}
+
+SharedMemoryServer::~SharedMemoryServer()
+{
+    munmap(m_region, sizeof(SharedRegion));
+    shm_unlink(m_name.c_str());
+}
+
+void SharedMemoryServer::publish(const SharedTelemetry &telemetry)
+{
+    m_region->telemetry.write(telemetry);
+}
+
+bool SharedMemoryServer::pollCommand(SharedCommand &command)
+{
+    SharedCommand latest;
+    if (!m_region->command.tryRead(latest))
+    {
+        ++m_busyCommandPolls;
+        // client died in the middle of a write, last taken command is put back so clients can write again
+        std::uint32_t sequence;
+        if (m_region->command.stalled(writerTimeoutMs, &sequence)
+            && m_region->command.writeIfUnchanged(m_lastCommand, sequence))
+            ++m_commandRecoveries;
+        return false;
+    }
+    if (latest.id == m_lastCommand.id)
+        return false;
+    m_lastCommand = latest;
+    command = latest;
+    return true;
+}
+
+std::uint64_t SharedMemoryServer::getBusyCommandPolls() const
+{
+    return m_busyCommandPolls;
+}
+
+std::uint64_t SharedMemoryServer::getCommandRecoveries() const
+{
+    return m_commandRecoveries;
+}
+
+SharedMemoryClient::SharedMemoryClient(const std::string &name)
+    : m_region(nullptr)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        throw systemError("can not open shared memory", name);
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(SharedRegion)))
+    {
+        close(fd);
+        throw std::runtime_error("shared memory " + name + " is not created by platform");
+    }
+    m_region = mapRegion(fd, name);
+    if (m_region->magic != regionMagic || m_region->version != regionVersion)
+    {
+        munmap(m_region, sizeof(SharedRegion));
+        throw std::runtime_error("shared memory " + name + " has wrong version");
+    }
+}
+
+SharedMemoryClient::~SharedMemoryClient()
+{
+    munmap(m_region, sizeof(SharedRegion));
+}
+
+bool SharedMemoryClient::readTelemetry(SharedTelemetry &telemetry) const
+{
+    return m_region->telemetry.read(telemetry, writerTimeoutMs);
+}
+
+void SharedMemoryClient::sendCommand(const SharedCommand &command)
+{
+    SharedCommand next = command;
+    next.id = m_region->lastCommandId.fetch_add(1, std::memory_order_relaxed) + 1;
+    SharedCommand previous;
+    std::uint32_t sequence;
+    while (!((m_region->command.tryRead(previous, &sequence) || m_region->command.stalled(writerTimeoutMs, &sequence))
+             && m_region->command.writeIfUnchanged(next, sequence)))
+        std::this_thread::yield();
+}
+}
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "platformState.hpp"
+
+namespace hexapod
+{
+    struct SharedLegState
+    {
+        double x;        // LegCoodinates in leg local coordinates
+        double y;
+        double height;
+        int legPosition; // Leg::LegPosition
+        double angles[jointsPerLeg]; // joint angles in degrees, A B C
+    };
+
+    /*!
+     * \brief SharedTelemetry - platform state published on every tick
+     */
+    struct SharedTelemetry
+    {
+        std::uint64_t tick;
+        double tickUs;      // planner work time of this tick
+        double maxTickUs;
+        std::uint64_t rejectedCommands; // commands with non-finite values or body height <= 0
+        std::uint64_t busyCommandPolls; // ticks command could not be read, a client was writing it
+        std::uint64_t commandRecoveries; // commands left half written by dead clients and dropped
+        double bodyHeight;
+        double velocityX;
+        double velocityY;
+        double rotation;
+        int stepStyle;      // Platform::StepStyle
+        SharedLegState legs[legsCount];
+    };
+
+    /*!
+     * \brief SharedCommand - command from external controller, applied on next tick
+     */
+    struct SharedCommand
+    {
+        std::uint64_t id;   // set by SharedMemoryClient::sendCommand
+        double velocityX;
+        double velocityY;
+        double rotation;
+        double bodyHeight;
+        int stepStyle;      // Platform::StepStyle
+    };
+
+    /*!
+     * \brief Seqlock - value shared between processes without locks.
+     *        Writers never wait for readers, readers retry if value changed while they copied it.
+     *        Data is copied by relaxed atomic words, so there is no data race.
+     *        Sequence is odd while a write is in progress, it is stored together with the steady clock time
+     *        the write started at, so a write left unfinished by a dead process can be found by stalled()
+     */
+    template <typename T>
+    class Seqlock
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Seqlock needs trivially copyable data");
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared memory needs lock free atomics");
+        static const size_t wordsCount = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    public:
+        /*!
+         * \brief write - single writer version. Write left unfinished by previous writer is overwritten
+         */
+        void write(const T &value)
+        {
+            const std::uint32_t locked = lockedSequence(sequenceOf(m_state.load(std::memory_order_relaxed)));
+            m_state.store(pack(locked), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            store(value);
+            m_state.store(pack(locked + 1), std::memory_order_release);
+        }
+        /*!
+         * \brief writeIfUnchanged - version for many writers: write only if nobody wrote
+         *        since tryRead() returned expected sequence, writers take turns on odd sequence.
+         *        Odd sequence returned by stalled() takes the turn of a writer that died in the middle of a write
+         */
+        bool writeIfUnchanged(const T &value, std::uint32_t expected)
+        {
+            std::uint64_t state = m_state.load(std::memory_order_relaxed);
+            if (sequenceOf(state) != expected)
+                return false;
+            const std::uint32_t locked = lockedSequence(expected);
+            if (!m_state.compare_exchange_strong(state, pack(locked), std::memory_order_acquire))
+                return false;
+            std::atomic_thread_fence(std::memory_order_release);
+            store(value);
+            m_state.store(pack(locked + 1), std::memory_order_release);
+            return true;
+        }
+        /*!
+         * \brief read - consistent copy of the value, waits while a write is in progress.
+         *        Only for writers that can not die in the middle of a write, e.g. threads of the same process
+         * \return sequence number of the copy, it changes on every write
+         */
+        std::uint32_t read(T &value) const
+        {
+            std::uint32_t sequence;
+            while (!tryRead(value, &sequence))
+            {
+            }
+            return sequence;
+        }
+        /*!
+         * \brief read - consistent copy of the value, waits while a write is in progress,
+         *        but not for a write that started more than timeoutMs ago
+         * \return false if writer is stalled, value is not changed then
+         */
+        bool read(T &value, std::uint32_t timeoutMs) const
+        {
+            std::uint32_t sequence;
+            while (!tryRead(value))
+            {
+                if (stalled(timeoutMs, &sequence))
+                    return false;
+            }
+            return true;
+        }
+        /*!
+         * \brief tryRead - single attempt of read() that never waits, side that must not hang uses it
+         * \return false if a write was in progress or happened during the copy, value is not changed then
+         */
+        bool tryRead(T &value, std::uint32_t *sequence = nullptr) const
+        {
+            const std::uint64_t before = m_state.load(std::memory_order_acquire);
+            if (sequenceOf(before) & 1)
+                return false;
+            std::uint64_t words[wordsCount];
+            for (size_t i = 0; i < wordsCount; ++i)
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_state.load(std::memory_order_relaxed) != before)
+                return false;
+            std::memcpy(&value, words, sizeof(T));
+            if (sequence)
+                *sequence = sequenceOf(before);
+            return true;
+        }
+        /*!
+         * \brief stalled - a write started more than timeoutMs ago and is still not finished,
+         *        its writer is taken as dead. Sequence to take the turn over with writeIfUnchanged() is returned
+         */
+        bool stalled(std::uint32_t timeoutMs, std::uint32_t *sequence) const
+        {
+            const std::uint64_t state = m_state.load(std::memory_order_acquire);
+            if (!(sequenceOf(state) & 1))
+                return false;
+            if (static_cast<std::uint32_t>(nowMs() - static_cast<std::uint32_t>(state >> 32)) < timeoutMs)
+                return false;
+            *sequence = sequenceOf(state);
+            return true;
+        }
+
+    private:
+        static std::uint32_t sequenceOf(std::uint64_t state)
+        {
+            return static_cast<std::uint32_t>(state);
+        }
+        // odd sequence stays odd on takeover, so readers keep skipping the half written value
+        static std::uint32_t lockedSequence(std::uint32_t sequence)
+        {
+            return sequence + ((sequence & 1) ? 2 : 1);
+        }
+        // steady clock is CLOCK_MONOTONIC, it is the same for all processes
+        static std::uint32_t nowMs()
+        {
+            return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+        static std::uint64_t pack(std::uint32_t sequence)
+        {
+            return (static_cast<std::uint64_t>(nowMs()) << 32) | sequence;
+        }
+        void store(const T &value)
+        {
+            std::uint64_t words[wordsCount] = {};
+            std::memcpy(words, &value, sizeof(T));
+            for (size_t i = 0; i < wordsCount; ++i)
+                m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        // sequence in low half, time in ms the last write started in high half
+        alignas(cacheLineSize) std::atomic<std::uint64_t> m_state;
+        std::atomic<std::uint64_t> m_words[wordsCount];
+    };
+
+    /*!
+     * \brief SharedRegion - layout of POSIX shared memory object
+     */
+    struct SharedRegion
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::atomic<std::int32_t> serverPid;      // process of the platform that owns the object
+        std::atomic<std::uint64_t> lastCommandId; // taken by clients for their commands
+        alignas(cacheLineSize) Seqlock<SharedTelemetry> telemetry;
+        alignas(cacheLineSize) Seqlock<SharedCommand> command;
+    };
+
+    /*!
+     * \brief writerTimeoutMs - writer that has not finished its write in this time is taken as dead
+     */
+    const std::uint32_t writerTimeoutMs = 200;
+
+    /*!
+     * \brief SharedMemoryServer - platform side: creates shared memory object,
+     *        publishes telemetry and takes commands. Removes the object in destructor
+     */
+    class SharedMemoryServer
+    {
+    public:
+        /*!
+         * \brief SharedMemoryServer - name is POSIX shm name like "/hexapod". Object left by a platform
+         *        process that is not running any more is taken over, clients attached to it stay attached.
+         *        Throws std::runtime_error if object can not be created or is used by other process
+         */
+        explicit SharedMemoryServer(const std::string &name);
+        ~SharedMemoryServer();
+        SharedMemoryServer(const SharedMemoryServer &) = delete;
+        SharedMemoryServer &operator=(const SharedMemoryServer &) = delete;
+
+        void publish(const SharedTelemetry &telemetry);
+        /*!
+         * \brief pollCommand - get command if a new one was sent since last call.
+         *        Never waits: if a client is writing the command right now it is taken on next call.
+         *        Command a client died in the middle of is dropped after writerTimeoutMs, so other clients
+         *        can send commands again
+         */
+        bool pollCommand(SharedCommand &command);
+        // calls of pollCommand() that found command being written
+        std::uint64_t getBusyCommandPolls() const;
+        // half written commands dropped
+        std::uint64_t getCommandRecoveries() const;
+
+    private:
+        // object of a dead platform process, pid of this process is set if so
+        bool takeOverStaleRegion();
+
+        std::string m_name;
+        SharedRegion *m_region;
+        SharedCommand m_lastCommand;
+        std::uint64_t m_busyCommandPolls;
+        std::uint64_t m_commandRecoveries;
+    };
+
+    /*!
+     * \brief SharedMemoryClient - external controller side, opens object created by platform
+     */
+    class SharedMemoryClient
+    {
+    public:
+        /*!
+         * \brief SharedMemoryClient - throws std::runtime_error if platform did not create the object
+         */
+        explicit SharedMemoryClient(const std::string &name);
+        ~SharedMemoryClient();
+        SharedMemoryClient(const SharedMemoryClient &) = delete;
+        SharedMemoryClient &operator=(const SharedMemoryClient &) = delete;
+
+        /*!
+         * \brief readTelemetry - latest published state
+         * \return false if platform died in the middle of publishing, telemetry is not changed then
+         */
+        bool readTelemetry(SharedTelemetry &telemetry) const;
+        /*!
+         * \brief sendCommand - command id is assigned here, several clients can send commands.
+         *        Waits at most writerTimeoutMs for a client that died in the middle of sending
+         */
+        void sendCommand(const SharedCommand &command);
+
+    private:
+        SharedRegion *m_region;
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace hexapod
+{
+    /*!
+     * \brief StageTiming - how long one stage of control loop works on a tick (sleep is not counted)
+     */
+    struct StageTiming
+    {
+        unsigned long long ticks;
+        double lastUs;
+        double maxUs;
+        double averageUs;
+    };
+
+    /*!
+     * \brief StageTimer - collects StageTiming in one thread, can be read from any other thread
+     */
+    class StageTimer
+    {
+    public:
+        StageTimer()
+            : m_ticks(0), m_lastUs(0), m_maxUs(0), m_totalUs(0)
+        {
+        }
+        void start()
+        {
+            m_start = std::chrono::steady_clock::now();
+        }
+        void stop()
+        {
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_start).count();
+            m_lastUs.store(us, std::memory_order_relaxed);
+            if (us > m_maxUs.load(std::memory_order_relaxed))
+                m_maxUs.store(us, std::memory_order_relaxed);
+            m_totalUs.store(m_totalUs.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+            m_ticks.fetch_add(1, std::memory_order_relaxed);
+        }
+        StageTiming get() const
+        {
+            StageTiming timing;
+            timing.ticks = m_ticks.load(std::memory_order_relaxed);
+            timing.lastUs = m_lastUs.load(std::memory_order_relaxed);
+            timing.maxUs = m_maxUs.load(std::memory_order_relaxed);
+            timing.averageUs = timing.ticks ? m_totalUs.load(std::memory_order_relaxed) / timing.ticks : 0;
+            return timing;
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_start;
+        std::atomic<unsigned long long> m_ticks;
+        std::atomic<double> m_lastUs;
+        std::atomic<double> m_maxUs;
+        std::atomic<double> m_totalUs;
+    };
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include "platformState.hpp"
+
+namespace hexapod
+{
+    /*!
+     * \brief TripleBuffer - lock-free channel from one writer thread to one reader thread.
+     *        Reader always gets the latest published value, old values are dropped.
+     *        Neither side ever waits for the other
+     */
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        TripleBuffer()
+            : m_shared(1)
+            , m_write(0)
+            , m_read(2)
+        {
+        }
+        /*!
+         * \brief writeBuffer - value to fill before publish(), only writer thread uses it
+         */
+        T &writeBuffer()
+        {
+            return m_buffers[m_write].value;
+        }
+        /*!
+         * \brief publish - make write buffer visible to reader and take a free buffer for next write
+         */
+        void publish()
+        {
+            m_write = m_shared.exchange(m_write | dirtyBit, std::memory_order_acq_rel) & indexMask;
+        }
+        /*!
+         * \brief update - take latest published value if there is a new one
+         * \return true if readBuffer() changed
+         */
+        bool update()
+        {
+            if ((m_shared.load(std::memory_order_relaxed) & dirtyBit) == 0)
+                return false;
+            m_read = m_shared.exchange(m_read, std::memory_order_acq_rel) & indexMask;
+            return true;
+        }
+        const T &readBuffer() const
+        {
+            return m_buffers[m_read].value;
+        }
+
+    private:
+        static const int indexMask = 3;
+        static const int dirtyBit = 4;
+        // each buffer in its own cache lines, writer and reader do not share them
+        struct alignas(cacheLineSize) Slot
+        {
+            T value;
+        };
+        Slot m_buffers[3];
+        alignas(cacheLineSize) std::atomic<int> m_shared;
+        alignas(cacheLineSize) int m_write;
+        alignas(cacheLineSize) int m_read;
+    };
+}
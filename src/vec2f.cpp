@@ -1,12 +1,9 @@
 #include "vec2f.hpp"
+#include "fastMath.hpp"
 #include <cmath>
 
 namespace hexapod
 {
-namespace
-{
-    constexpr static const double PI = 3.141592654;
-}
 double vec2f::getDistance(vec2f first, vec2f second)
 {
     return sqrt(first.x * second.x + first.y * second.y);
@@ -14,9 +11,10 @@ double vec2f::getDistance(vec2f first, vec2f second)
 
 void vec2f::rotate(double angle)
 {
-    double tmpAngle = angle * PI / 180.0;
-    double tmpx = (cos(tmpAngle) * x) - (sin(tmpAngle) * y);
-    double tmpy = (sin(tmpAngle) * x) + (cos(tmpAngle) * y);
+    double sinA, cosA;
+    math::sincos(angle * math::degToRad, sinA, cosA);
+    double tmpx = (cosA * x) - (sinA * y);
+    double tmpy = (sinA * x) + (cosA * y);
     x = tmpx;
     y = tmpy;
 }
@@ -52,28 +50,16 @@ vec2f &vec2f::operator -= (const vec2f &rhs)
     return *this;
 }
 
-int vec2f::radToDeg(float rad)
+double vec2f::radToDeg(double rad)
 {
-    return rad * (180 / M_PI);
+    return rad * math::radToDeg;
 }
 
 double vec2f::vectorAngle()
 {
-    if (x == 0) // special cases
-        return (y > 0)    ? 90
-               : (y == 0) ? 0
-                          : 270;
-    else if (y == 0) // special cases
-        return (x >= 0) ? 0
-                        : 180;
-    int ret = radToDeg(atanf((float)y / x));
-    if (x < 0 && y < 0) // quadrant Ⅲ
-        ret = 180 + ret;
-    else if (x < 0)             // quadrant Ⅱ
-        ret = 180 + ret;        // it actually substracts
-    else if (y < 0)             // quadrant Ⅳ
-        ret = 270 + (90 + ret); // it actually substracts
-    return ret;
+    // angle in degrees in range [0, 360)
+    double ret = radToDeg(math::atan2(y, x));
+    return (ret < 0) ? ret + 360 : ret;
 }
 
 }
@@ -21,7 +21,7 @@ namespace hexapod
         vec2f &operator += (const vec2f &rhs);
         vec2f &operator -= (const vec2f &rhs);
         double size();
-        int radToDeg(float rad);
+        double radToDeg(double rad);
         double vectorAngle();
     };
 
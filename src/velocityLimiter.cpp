@@ -0,0 +1,135 @@
+#include "velocityLimiter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace hexapod
+{
+namespace
+{
+// scale is found with maxScale / 2^12 precision
+const int bisectionSteps = 12;
+}
+
+VelocityLimiter::VelocityLimiter(double maxServoSpeed)
+    : m_maxScale(1)
+    , m_report{1, -1, 0, 0}
+{
+    for (int servo = 0; servo < servosCount; ++servo)
+        setServoSpeed(servo, maxServoSpeed);
+}
+
+void VelocityLimiter::setServoSpeed(int servo, double degreesPerSecond)
+{
+    if (servo < 0 || servo >= servosCount)
+        throw std::runtime_error("wrong servo number");
+    if (!(degreesPerSecond > 0))
+        throw std::runtime_error("servo speed must be positive");
+    m_servoSpeed[servo] = degreesPerSecond;
+}
+
+double VelocityLimiter::getServoSpeed(int servo) const
+{
+    if (servo < 0 || servo >= servosCount)
+        throw std::runtime_error("wrong servo number");
+    return m_servoSpeed[servo];
+}
+
+void VelocityLimiter::setMaxScale(double maxScale)
+{
+    if (!(maxScale > 0))
+        throw std::runtime_error("max scale must be positive");
+    m_maxScale = maxScale;
+}
+
+double VelocityLimiter::limit(const KinematicModel &model, const PlatformState &before, PlatformState &state,
+                              double xoffset, double yoffset, double rotation, int periodMs)
+{
+    const double period = periodMs / 1000.0;
+    m_report.scale = m_maxScale;
+    m_report.bottleneckServo = -1;
+    m_report.requiredSpeed = 0;
+    m_report.infeasibleServos = 0;
+    if (period <= 0)
+    {
+        moveGroundedLegs(state, model, xoffset * m_maxScale, yoffset * m_maxScale, rotation * m_maxScale);
+        return m_report.scale;
+    }
+
+    if (tryScale(model, before, state, m_maxScale, xoffset, yoffset, rotation, period, 0, nullptr, &m_report) <= 1)
+        return m_report.scale;
+    // joints too fast without any body movement can not be helped by scale
+    unsigned infeasible = 0;
+    tryScale(model, before, state, 0, xoffset, yoffset, rotation, period, 0, &infeasible, nullptr);
+    m_report.infeasibleServos = infeasible;
+
+    // joint speed grows with scale, IK is solved again for every try
+    double feasible = 0;
+    double tooFast = m_maxScale;
+    if (infeasible != 0 && tryScale(model, before, state, m_maxScale, xoffset, yoffset, rotation, period, infeasible, nullptr, nullptr) <= 1)
+        feasible = m_maxScale;
+    for (int step = 0; step < bisectionSteps && feasible < m_maxScale; ++step)
+    {
+        const double scale = (feasible + tooFast) / 2;
+        if (tryScale(model, before, state, scale, xoffset, yoffset, rotation, period, infeasible, nullptr, nullptr) <= 1)
+            feasible = scale;
+        else
+            tooFast = scale;
+    }
+    tryScale(model, before, state, feasible, xoffset, yoffset, rotation, period, infeasible, nullptr, nullptr);
+    m_report.scale = feasible;
+    return m_report.scale;
+}
+
+double VelocityLimiter::tryScale(const KinematicModel &model, const PlatformState &before, PlatformState &state, double scale,
+                                 double xoffset, double yoffset, double rotation, double period,
+                                 unsigned skipServos, unsigned *tooFastServos, Report *report)
+{
+    // every try starts from the same state
+    std::copy(before.xPos, before.xPos + legsCount, state.xPos);
+    std::copy(before.yPos, before.yPos + legsCount, state.yPos);
+    std::copy(before.angleA, before.angleA + legsCount, state.angleA);
+    std::copy(before.angleB, before.angleB + legsCount, state.angleB);
+    std::copy(before.angleC, before.angleC + legsCount, state.angleC);
+    std::copy(before.jointAngles, before.jointAngles + servosCount, state.jointAngles);
+    moveGroundedLegs(state, model, xoffset * scale, yoffset * scale, rotation * scale);
+    unsigned failedLegs = 0;
+    solveLegs(state, model, &failedLegs);
+
+    // joints of legs in air jump to gait targets, they do not depend on velocity
+    double worstRatio = 0; // required speed / max speed
+    for (int leg = 0; leg < legsCount; ++leg)
+    {
+        if (before.phase[leg] != 0 || state.phase[leg] != 0) // Leg::on_ground
+            continue;
+        for (int joint = 0; joint < jointsPerLeg; ++joint)
+        {
+            int servo = model.servos[leg][joint];
+            if (skipServos & (1u << servo))
+                continue;
+            // unsolved leg keeps old angles, it is not standing still
+            double speed = (failedLegs & (1u << leg)) ? std::numeric_limits<double>::infinity()
+                                                      : std::fabs(state.jointAngles[servo] - before.jointAngles[servo]) / period;
+            double ratio = speed / m_servoSpeed[servo];
+            if (ratio > 1 && tooFastServos)
+                *tooFastServos |= 1u << servo;
+            if (ratio > worstRatio)
+            {
+                worstRatio = ratio;
+                if (report)
+                {
+                    report->bottleneckServo = servo;
+                    report->requiredSpeed = speed;
+                }
+            }
+        }
+    }
+    return worstRatio;
+}
+
+const VelocityLimiter::Report &VelocityLimiter::getReport() const
+{
+    return m_report;
+}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "platformState.hpp"
+#include "robotDescription.hpp"
+
+namespace hexapod
+{
+    /*!
+     * \brief VelocityLimiter - finds how fast body can move so every servo can follow its joint.
+     *        Body move is tried with a scale of commanded velocity, joint speeds are taken from
+     *        inverse kinematics solutions before and after it. Scale is found by bisection, only
+     *        legs standing on the ground are used as only they depend on body velocity.
+     *        Joints that are too fast even without body movement (e.g. body height changed) or legs
+     *        that can not be solved at all are reported as infeasible and do not limit the scale
+     */
+    class VelocityLimiter
+    {
+    public:
+        struct Report
+        {
+            double scale;               // applied to commanded velocity and rotation
+            int bottleneckServo;        // servo with highest load at max scale, -1 if no grounded joint moves
+            double requiredSpeed;       // degrees per second bottleneck servo needed at max scale
+            unsigned infeasibleServos;  // bit per servo that can not follow at any scale
+        };
+
+        explicit VelocityLimiter(double maxServoSpeed = 300);
+        /*!
+         * \brief setServoSpeed - max slew rate of servo in degrees per second
+         */
+        void setServoSpeed(int servo, double degreesPerSecond);
+        double getServoSpeed(int servo) const;
+        /*!
+         * \brief setMaxScale - 1 only slows down too aggressive commands,
+         *        bigger values let timid commands be speeded up to what servos can do
+         */
+        void setMaxScale(double maxScale);
+        /*!
+         * \brief limit - move legs on the ground for a tick of periodMs milliseconds with the biggest
+         *        scale of commanded offsets that servos can follow, same as moveGroundedLegs otherwise.
+         *        model - geometry of the robot the state belongs to, before - state at start of the tick,
+         *        state - gets moved feet and their joint angles
+         * \return applied scale
+         */
+        double limit(const KinematicModel &model, const PlatformState &before, PlatformState &state,
+                     double xoffset, double yoffset, double rotation, int periodMs);
+        const Report &getReport() const;
+
+    private:
+        // move with scale and solve IK, worst required/max speed of servos not in skipServos,
+        // infinity if a grounded leg with such servos can not be solved
+        double tryScale(const KinematicModel &model, const PlatformState &before, PlatformState &state, double scale,
+                        double xoffset, double yoffset, double rotation, double period,
+                        unsigned skipServos, unsigned *tooFastServos, Report *report);
+
+        double m_servoSpeed[servosCount];
+        double m_maxScale;
+        Report m_report;
+    };
+}
@@ -0,0 +1,69 @@
+// Max error of polynomial math against libm, bounds are the table in src/fastMath.hpp
+#include "fastMath.hpp"
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace hexapod;
+
+namespace
+{
+struct Errors
+{
+    double atan2;
+    double acos;
+    double sincos;
+};
+
+template <math::Accuracy accuracy>
+Errors measure()
+{
+    const int points = 2000000;
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> plane(-1000, 1000);
+    std::uniform_real_distribution<double> unit(-1, 1);
+    Errors errors = {0, 0, 0};
+    for (int i = 0; i < points; ++i)
+    {
+        const double y = plane(random);
+        const double x = plane(random);
+        errors.atan2 = std::fmax(errors.atan2, std::fabs(math::atan2<accuracy>(y, x) - std::atan2(y, x)));
+
+        const double c = unit(random);
+        errors.acos = std::fmax(errors.acos, std::fabs(math::acos<accuracy>(c) - std::acos(c)));
+
+        const double angle = plane(random);
+        double s;
+        double co;
+        math::sincos<accuracy>(angle, s, co);
+        errors.sincos = std::fmax(errors.sincos, std::fabs(s - std::sin(angle)));
+        errors.sincos = std::fmax(errors.sincos, std::fabs(co - std::cos(angle)));
+    }
+    // ends of domains and axes
+    const double edges[] = {-1, -0.5, 0, 0.5, 1};
+    for (double e : edges)
+    {
+        errors.acos = std::fmax(errors.acos, std::fabs(math::acos<accuracy>(e) - std::acos(e)));
+        for (double f : edges)
+            errors.atan2 = std::fmax(errors.atan2, std::fabs(math::atan2<accuracy>(e, f) - std::atan2(e, f)));
+    }
+    return errors;
+}
+
+bool check(const char *name, const Errors &errors, const Errors &bounds)
+{
+    bool passed = errors.atan2 <= bounds.atan2 && errors.acos <= bounds.acos && errors.sincos <= bounds.sincos;
+    std::printf("%-9s atan2 %.2e (%.2e)  acos %.2e (%.2e)  sincos %.2e (%.2e)  %s\n", name,
+                errors.atan2, bounds.atan2, errors.acos, bounds.acos, errors.sincos, bounds.sincos,
+                passed ? "ok" : "FAILED");
+    return passed;
+}
+}
+
+int main()
+{
+    bool passed = check("Libm", measure<math::Libm>(), Errors{0, 0, 0});
+    passed = check("Balanced", measure<math::Balanced>(), Errors{1.2e-5, 2.2e-8, 2.7e-9}) && passed;
+    passed = check("Fast", measure<math::Fast>(), Errors{1.51e-3, 6.8e-5, 6.8e-4}) && passed;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+// Gait cache playback must give the same servo frames the planner gives without it
+#include "platform.hpp"
+#include <cstdio>
+#include <vector>
+
+using namespace hexapod;
+
+namespace
+{
+enum Mode
+{
+    Plain,
+    Collision,
+    Limiter
+};
+
+struct Run
+{
+    std::vector<double> frames;  // servo angles of all ticks
+    GaitCache::Stats stats;
+};
+
+Run run(Mode mode, size_t cacheBytes)
+{
+    Run result;
+    Platform platform([](int) {}, [&result](int, double angle) { result.frames.push_back(angle); });
+    if (mode == Collision)
+        platform.setCollisionCheck(true, 25, 20);
+    if (mode == Limiter)
+    {
+        VelocityLimiter limiter(150);
+        limiter.setMaxScale(2);
+        platform.setVelocityLimiter(limiter);
+    }
+    platform.enableGaitCache(cacheBytes);
+
+    struct Command
+    {
+        double x;
+        double y;
+        double rotation;
+        Platform::StepStyle style;
+    };
+    const Command commands[] = {{3, 0, 0, Platform::OneLeg}, {0, 2, 3, Platform::TwoLegs},
+                                {-2, 1, 0, Platform::ThreeLegs}, {1, 1, -2, Platform::OneLeg}};
+    int tick = 0;
+    // commands come back after others, small cache has to drop their cycles in between
+    for (int round = 0; round < 3; ++round)
+    {
+        for (const Command &command : commands)
+        {
+            platform.setVelocity(vec2f(command.x, command.y), command.rotation);
+            platform.setWalkingStyle(command.style);
+            for (int i = 0; i < 150; ++i, ++tick)
+            {
+                if (tick == 275)
+                    platform.setLegCenter(2, -60, 80, 0);  // in the middle of a played cycle
+                platform.procedureGo();
+            }
+        }
+    }
+    result.stats = platform.getGaitCacheStats();
+    return result;
+}
+
+bool check(const char *name, Mode mode, size_t cacheBytes, bool needEvictions)
+{
+    const Run planned = run(mode, 0);
+    const Run cached = run(mode, cacheBytes);
+    size_t firstDifference = planned.frames.size();
+    for (size_t i = 0; i < planned.frames.size() && i < cached.frames.size(); ++i)
+    {
+        if (planned.frames[i] != cached.frames[i])
+        {
+            firstDifference = i;
+            break;
+        }
+    }
+    const bool same = planned.frames.size() == cached.frames.size() && firstDifference == planned.frames.size();
+    const bool passed = same && cached.stats.hits > 0 && (!needEvictions || cached.stats.evictions > 0);
+    std::printf("%-22s hits %llu misses %llu cycles %llu evictions %llu  %s", name, cached.stats.hits,
+                cached.stats.misses, cached.stats.cycles, cached.stats.evictions, passed ? "ok" : "FAILED");
+    if (!same)
+        std::printf(" (frames differ from servo value %zu)", firstDifference);
+    std::printf("\n");
+    return passed;
+}
+}
+
+int main()
+{
+    bool passed = check("plain", Plain, 1 << 20, false);
+    passed = check("plain, small cache", Plain, 24 << 10, true) && passed;
+    passed = check("collision", Collision, 1 << 20, false) && passed;
+    passed = check("limiter", Limiter, 1 << 20, false) && passed;
+    return passed ? 0 : 1;
+}
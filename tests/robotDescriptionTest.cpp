@@ -0,0 +1,89 @@
+// Validation of robot descriptions: every broken file or description must throw std::runtime_error
+#include "robotDescription.hpp"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using namespace hexapod;
+
+namespace
+{
+const char *fileName = "robotDescriptionTest.cfg";
+
+// true if loading text throws std::runtime_error with given part in message
+bool loadFails(const char *name, const std::string &text, const std::string &part)
+{
+    {
+        std::ofstream file(fileName);
+        file << text;
+    }
+    std::string what;
+    try
+    {
+        RobotDescription::loadFromFile(fileName);
+    }
+    catch (const std::runtime_error &e)
+    {
+        what = e.what();
+    }
+    std::remove(fileName);
+    const bool passed = !what.empty() && what.find(part) != std::string::npos;
+    std::printf("%-24s %s  %s\n", name, passed ? "ok" : "FAILED", what.c_str());
+    return passed;
+}
+
+bool compileFails(const char *name, const std::function<void(RobotDescription &)> &change)
+{
+    RobotDescription description = RobotDescription::getDefault();
+    change(description);
+    std::string what;
+    try
+    {
+        KinematicModel::compile(description);
+    }
+    catch (const std::runtime_error &e)
+    {
+        what = e.what();
+    }
+    const bool passed = !what.empty();
+    std::printf("%-24s %s  %s\n", name, passed ? "ok" : "FAILED", what.c_str());
+    return passed;
+}
+}
+
+int main()
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inf = std::numeric_limits<double>::infinity();
+    bool passed = loadFails("unknown key", "frame.d = 10\n", "unknown key");
+    passed = loadFails("unknown leg field", "leg.0.knee = 10\n", "unknown key") && passed;
+    passed = loadFails("wrong leg number", "leg.6.side = left\n", "wrong leg number") && passed;
+    passed = loadFails("duplicate servo", "leg.1.servos = 0 4 5\n", "used twice") && passed;
+    passed = loadFails("unreachable center", "leg.2.center = 500 0\n", "not reachable") && passed;
+    passed = loadFails("missing value", "leg.0.mount = 72\n", "") && passed;
+    passed = compileFails("NaN mount", [nan](RobotDescription &d) { d.legs[0].mountX = nan; }) && passed;
+    passed = compileFails("infinite mount", [inf](RobotDescription &d) { d.legs[3].mountY = inf; }) && passed;
+    passed = compileFails("NaN center", [nan](RobotDescription &d) { d.legs[1].centerX = nan; }) && passed;
+    passed = compileFails("NaN attachment", [nan](RobotDescription &d) { d.legs[5].attachmentAngle = nan; }) && passed;
+    passed = compileFails("infinite leg part", [inf](RobotDescription &d) { d.aLegPart = inf; }) && passed;
+
+    // default description and a valid file load fine
+    try
+    {
+        KinematicModel::compile(RobotDescription::getDefault());
+        std::ofstream(fileName) << "frame.a = 121\nleg.0.center = 70 71\n";
+        RobotDescription description = RobotDescription::loadFromFile(fileName);
+        passed = description.aLegPart == 121 && description.legs[0].centerY == 71 && passed;
+    }
+    catch (const std::exception &e)
+    {
+        std::printf("valid description FAILED  %s\n", e.what());
+        passed = false;
+    }
+    std::remove(fileName);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+#include "soakTester.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+namespace
+{
+void printReport(const hexapod::SoakReport &report)
+{
+    const char *kinds[] = {"exception", "ik failure", "state violation", "slow tick"};
+    std::printf("ticks %llu, max %.1f us, p99.99 %.1f us, average %.2f us\n",
+                report.ticks, report.maxUs, report.p9999Us, report.averageUs);
+    std::printf("exceptions %llu, ik failures %llu, violations %llu, slow ticks %llu\n",
+                report.exceptions, report.ikFailures, report.violations, report.slowTicks);
+    for (const hexapod::SoakFailure &failure : report.failures)
+    {
+        std::printf("seed %llu tick %d %s: %s\n", static_cast<unsigned long long>(failure.seed), failure.tick,
+                    kinds[failure.kind], failure.what.c_str());
+    }
+}
+}
+
+// hexapodSoak [seed [episodes]] - soak run on all cores
+// hexapodSoak --replay episodeSeed - one failed episode again, seed is printed by soak run
+int main(int argc, char *argv[])
+{
+    try
+    {
+        hexapod::SoakConfig config;
+        bool replay = argc > 1 && std::strcmp(argv[1], "--replay") == 0;
+        if (replay && argc != 3)
+        {
+            std::fprintf(stderr, "usage: %s [seed [episodes]] | --replay episodeSeed\n", argv[0]);
+            return 2;
+        }
+        hexapod::SoakReport report;
+        if (replay)
+        {
+            report = hexapod::SoakTester(config).replay(std::strtoull(argv[2], nullptr, 0));
+        }
+        else
+        {
+            if (argc > 1)
+                config.seed = std::strtoull(argv[1], nullptr, 0);
+            if (argc > 2)
+                config.episodes = std::strtoull(argv[2], nullptr, 0);
+            report = hexapod::SoakTester(config).run();
+        }
+        printReport(report);
+        // feet out of reach are expected for adversarial commands, broken planner is not
+        return report.exceptions == 0 && report.violations == 0 ? 0 : 1;
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+}
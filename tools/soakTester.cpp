@@ -0,0 +1,384 @@
+#include "soakTester.hpp"
+#include "platform.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <limits>
+#include <thread>
+#include <unistd.h>
+
+namespace hexapod
+{
+namespace
+{
+std::uint64_t episodeSeed(std::uint64_t seed, std::uint64_t episode)
+{
+    // splitmix64, neighbor episodes get unrelated sequences
+    std::uint64_t z = seed + (episode + 1) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// features switched on and off during an episode
+struct Features
+{
+    bool multiRate = false;
+    std::unique_ptr<SharedMemoryClient> client;  // set while shared memory is attached
+};
+
+void toggleFeature(Platform &platform, Features &features, std::mt19937_64 &random, const SoakConfig &config,
+                   std::uint64_t seed)
+{
+    std::uniform_real_distribution<double> unit(0, 1);
+    const int feature = random() % 6;
+    if (features.multiRate && feature > 2)
+    {
+        // collision check, limiter and contact source are handed to running planner, the rest needs stopped threads
+        platform.stopMovementThread();
+        features.multiRate = false;
+        return;
+    }
+    switch (feature)
+    {
+    case 0:
+        platform.setCollisionCheck(unit(random) < 0.5);
+        break;
+    case 1:
+    {
+        VelocityLimiter limiter;
+        limiter.setMaxScale(1 + 3 * unit(random));
+        platform.setVelocityLimiter(limiter, unit(random) < 0.5);
+        break;
+    }
+    case 2:
+    {
+        const int descentSteps = 1 + random() % 3;
+        switch (random() % 3)
+        {
+        case 0:
+            platform.setContactSource(nullptr);
+            break;
+        case 1:
+            platform.setContactSource(std::make_shared<SimulatedContactSource>(), descentSteps);
+            break;
+        default: // every second foot touches early
+            platform.setContactSource(std::make_shared<SimulatedContactSource>([](int leg, double, double) {
+                return leg % 2 ? 12.0 : 0.0;
+            }), descentSteps);
+            break;
+        }
+        break;
+    }
+    case 3:
+        platform.enableGaitCache(unit(random) < 0.5 ? 0 : 1 << 16);
+        break;
+    case 4:
+        if (features.client)
+        {
+            features.client.reset();
+            platform.detachSharedMemory();
+        }
+        else
+        {
+            // other soak threads and processes have their own objects
+            const std::string name = "/hexapodSoak." + std::to_string(getpid()) + "." + std::to_string(seed);
+            platform.attachSharedMemory(name);
+            features.client.reset(new SharedMemoryClient(name));
+        }
+        break;
+    default:
+        platform.startMultiRateThreads(100, 10);
+        features.multiRate = true;
+        break;
+    }
+}
+
+void randomCommand(Platform &platform, Features &features, std::mt19937_64 &random, const SoakConfig &config)
+{
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::uniform_real_distribution<double> velocity(-config.maxVelocity, config.maxVelocity);
+    std::uniform_real_distribution<double> rotation(-config.maxRotation, config.maxRotation);
+    const double bodyHeight = config.model->bodyHeight;
+
+    if (unit(random) >= config.adversarialRate)
+    {
+        if (features.client && unit(random) < 0.5)
+        {
+            // same command from another process
+            SharedCommand command = {0, velocity(random), velocity(random), rotation(random),
+                                     bodyHeight * (0.5 + unit(random)), static_cast<int>(random() % 3)};
+            features.client->sendCommand(command);
+            return;
+        }
+        platform.setVelocity(vec2f(velocity(random), velocity(random)), rotation(random));
+        if (unit(random) < 0.2)
+            platform.setBodyHeight(bodyHeight * (0.5 + unit(random)));
+        if (unit(random) < 0.2)
+            platform.setWalkingStyle(static_cast<Platform::StepStyle>(random() % 3));
+        return;
+    }
+    switch (random() % 7)
+    {
+    case 0: // far beyond leg reach in one tick
+        platform.setVelocity(vec2f(velocity(random) * 50, velocity(random) * 50), 0);
+        break;
+    case 1:
+        platform.setVelocity(vec2f(0, 0), unit(random) < 0.5 ? -180 : 180);
+        break;
+    case 2:
+    {
+        const double heights[] = {0, -bodyHeight, 3 * bodyHeight, config.model->maxReach};
+        platform.setBodyHeight(heights[random() % 4]);
+        break;
+    }
+    case 3: // gait changed in the middle of a step
+        platform.setWalkingStyle(static_cast<Platform::StepStyle>(random() % 3));
+        break;
+    case 4:
+        platform.setVelocity(vec2f(0, 0), 0);
+        break;
+    case 5: // broken command from another process must be rejected
+        if (features.client)
+        {
+            const double values[] = {std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(), 0, -1};
+            const int field = random() % 4;
+            SharedCommand command = {0, 0, 0, 0, bodyHeight, 0};
+            double *fields[] = {&command.velocityX, &command.velocityY, &command.rotation, &command.bodyHeight};
+            *fields[field] = values[random() % 4];
+            features.client->sendCommand(command);
+        }
+        break;
+    default:
+        platform.setVelocity(vec2f(1e-300, -1e-300), 1e-300);
+        break;
+    }
+}
+
+// empty string if state is fine
+std::string checkState(const PlatformState &state)
+{
+    int inAir = 0;
+    for (int leg = 0; leg < legsCount; ++leg)
+    {
+        if (state.phase[leg] > Leg::moving_down)
+            return "leg " + std::to_string(leg) + " has phase " + std::to_string(state.phase[leg]);
+        if (!std::isfinite(state.xPos[leg]) || !std::isfinite(state.yPos[leg]) || !std::isfinite(state.height[leg]))
+            return "leg " + std::to_string(leg) + " position is not finite";
+        if (state.phase[leg] == Leg::on_ground)
+            continue;
+        ++inAir;
+        int next = (leg + 1) % legsCount;
+        if (state.phase[next] != Leg::on_ground)
+            return "neighbor legs " + std::to_string(leg) + " and " + std::to_string(next) + " are in air";
+    }
+    if (inAir > 3)
+        return std::to_string(inAir) + " legs are in air";
+    for (int servo = 0; servo < servosCount; ++servo)
+    {
+        if (!std::isfinite(state.jointAngles[servo]))
+            return "servo " + std::to_string(servo) + " angle is not finite";
+    }
+    return std::string();
+}
+}
+
+/*!
+ * \brief Histogram - tick latencies with 32 buckets per power of two nanoseconds
+ */
+class SoakTester::Histogram
+{
+public:
+    Histogram()
+        : m_counts(64 * subBuckets), m_count(0), m_totalUs(0), m_maxUs(0)
+    {
+    }
+    void add(double us)
+    {
+        ++m_counts[index(static_cast<std::uint64_t>(us * 1000))];
+        ++m_count;
+        m_totalUs += us;
+        m_maxUs = std::max(m_maxUs, us);
+    }
+    void merge(const Histogram &other)
+    {
+        for (size_t i = 0; i < m_counts.size(); ++i)
+            m_counts[i] += other.m_counts[i];
+        m_count += other.m_count;
+        m_totalUs += other.m_totalUs;
+        m_maxUs = std::max(m_maxUs, other.m_maxUs);
+    }
+    // upper bound of bucket with given share of ticks
+    double percentileUs(double share) const
+    {
+        const unsigned long long rank = static_cast<unsigned long long>(std::ceil(share * m_count));
+        unsigned long long seen = 0;
+        for (size_t i = 0; i < m_counts.size(); ++i)
+        {
+            seen += m_counts[i];
+            if (seen >= rank && seen > 0)
+                return std::min(upperBound(i) / 1000.0, m_maxUs);
+        }
+        return m_maxUs;
+    }
+    void fill(SoakReport &report) const
+    {
+        report.ticks = m_count;
+        report.maxUs = m_maxUs;
+        report.p9999Us = percentileUs(0.9999);
+        report.averageUs = m_count ? m_totalUs / m_count : 0;
+    }
+
+private:
+    static const int subBits = 5;
+    static const std::uint64_t subBuckets = 1 << subBits;
+
+    static size_t index(std::uint64_t ns)
+    {
+        if (ns < subBuckets)
+            return ns;
+        int shift = 0;
+        while (ns >> (shift + subBits + 1))
+            ++shift;
+        return (shift + 1) * subBuckets + ((ns >> shift) - subBuckets);
+    }
+    static double upperBound(size_t index)
+    {
+        if (index < subBuckets)
+            return index;
+        const int shift = static_cast<int>(index / subBuckets) - 1;
+        const std::uint64_t sub = subBuckets + index % subBuckets;
+        return static_cast<double>(((sub + 1) << shift) - 1);
+    }
+
+    std::vector<unsigned long long> m_counts;
+    unsigned long long m_count;
+    double m_totalUs;
+    double m_maxUs;
+};
+
+SoakTester::SoakTester(const SoakConfig &config)
+    : m_config(config)
+{
+    if (!m_config.model)
+        throw std::runtime_error("soak test needs kinematic model");
+    if (m_config.ticksPerEpisode < 1)
+        throw std::runtime_error("episode must have ticks");
+}
+
+SoakReport SoakTester::run() const
+{
+    unsigned threadsCount = m_config.threads ? m_config.threads : std::thread::hardware_concurrency();
+    threadsCount = std::max(1u, threadsCount);
+    std::vector<SoakReport> reports(threadsCount, SoakReport());
+    std::vector<Histogram> histograms(threadsCount);
+    std::atomic<std::uint64_t> nextEpisode(0);
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < threadsCount; ++i)
+    {
+        threads.emplace_back([this, i, &reports, &histograms, &nextEpisode]() {
+            for (std::uint64_t episode = nextEpisode++; episode < m_config.episodes; episode = nextEpisode++)
+                runEpisode(episodeSeed(m_config.seed, episode), reports[i], histograms[i]);
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    SoakReport result = SoakReport();
+    Histogram latency;
+    for (unsigned i = 0; i < threadsCount; ++i)
+    {
+        latency.merge(histograms[i]);
+        result.exceptions += reports[i].exceptions;
+        result.ikFailures += reports[i].ikFailures;
+        result.violations += reports[i].violations;
+        result.slowTicks += reports[i].slowTicks;
+        result.failures.insert(result.failures.end(), reports[i].failures.begin(), reports[i].failures.end());
+    }
+    latency.fill(result);
+    // stable order whatever thread ran an episode
+    std::sort(result.failures.begin(), result.failures.end(), [](const SoakFailure &a, const SoakFailure &b) {
+        return a.seed != b.seed ? a.seed < b.seed : a.tick != b.tick ? a.tick < b.tick : a.kind < b.kind;
+    });
+    if (result.failures.size() > m_config.maxFailures)
+        result.failures.resize(m_config.maxFailures);
+    return result;
+}
+
+SoakReport SoakTester::replay(std::uint64_t seed) const
+{
+    SoakReport result = SoakReport();
+    Histogram latency;
+    runEpisode(seed, result, latency);
+    latency.fill(result);
+    return result;
+}
+
+void SoakTester::runEpisode(std::uint64_t seed, SoakReport &report, Histogram &latency) const
+{
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> unit(0, 1);
+    // only multi-rate threads sleep, they run 1000 times faster than real time
+    Platform platform([](int ms) { std::this_thread::sleep_for(std::chrono::microseconds(ms)); },
+                      [](int, double) {}, 100, m_config.model);
+    Features features;
+    bool reported[SoakFailure::SlowTick + 1] = {};
+    auto fail = [&](SoakFailure::Kind kind, int tick, const std::string &what) {
+        if (!reported[kind] && report.failures.size() < m_config.maxFailures)
+            report.failures.push_back(SoakFailure{kind, seed, tick, what});
+        reported[kind] = true;
+    };
+
+    unsigned long long ikFailures = 0;
+    for (int tick = 0; tick < m_config.ticksPerEpisode; ++tick)
+    {
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            if (unit(random) < m_config.toggleRate)
+                toggleFeature(platform, features, random, m_config, seed);
+            if (unit(random) < m_config.commandRate)
+                randomCommand(platform, features, random, m_config);
+            if (features.multiRate)
+            {
+                // planner thread makes ticks now, state is checked after threads stop
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+            start = std::chrono::steady_clock::now();
+            platform.procedureGo();
+        }
+        catch (const std::exception &e)
+        {
+            // state may be broken after it, episode ends here
+            ++report.exceptions;
+            fail(SoakFailure::Exception, tick, e.what());
+            return;
+        }
+        const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        latency.add(us);
+
+        if (m_config.tickBudgetUs > 0 && us > m_config.tickBudgetUs)
+        {
+            ++report.slowTicks;
+            fail(SoakFailure::SlowTick, tick, std::to_string(us) + " us");
+        }
+        if (platform.getIkFailures() != ikFailures)
+        {
+            report.ikFailures += platform.getIkFailures() - ikFailures;
+            ikFailures = platform.getIkFailures();
+            fail(SoakFailure::IkFailure, tick, "foot out of reach");
+        }
+        std::string violation = checkState(platform.getState());
+        if (!violation.empty())
+        {
+            ++report.violations;
+            fail(SoakFailure::StateViolation, tick, violation);
+        }
+    }
+}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "robotDescription.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hexapod
+{
+    struct SoakConfig
+    {
+        std::uint64_t seed = 1;
+        std::uint64_t episodes = 1000;     // every episode is a new Platform with its own seed
+        int ticksPerEpisode = 1000;
+        unsigned threads = 0;              // 0 - all cores
+        double maxVelocity = 20;           // range of normal random commands
+        double maxRotation = 10;
+        double commandRate = 0.1;          // chance of new command on a tick
+        double adversarialRate = 0.05;     // chance that new command is extreme or flips gait
+        double toggleRate = 0.01;          // chance that a feature is switched on or off on a tick
+        double tickBudgetUs = 0;           // slower ticks are failures, 0 - not checked
+        size_t maxFailures = 1000;         // only counted after that
+        std::shared_ptr<const KinematicModel> model = KinematicModel::getDefault();
+    };
+
+    struct SoakFailure
+    {
+        enum Kind
+        {
+            Exception,
+            IkFailure,       // planned foot position can not be reached
+            StateViolation,  // broken gait invariant, see SoakTester
+            SlowTick
+        };
+        Kind kind;
+        std::uint64_t seed;  // SoakTester::replay(seed) repeats the episode
+        int tick;
+        std::string what;
+    };
+
+    struct SoakReport
+    {
+        unsigned long long ticks;
+        double maxUs;
+        double p9999Us;
+        double averageUs;
+        unsigned long long exceptions;
+        unsigned long long ikFailures;
+        unsigned long long violations;
+        unsigned long long slowTicks;
+        std::vector<SoakFailure> failures;  // first failure of each kind in every episode
+    };
+
+    /*!
+     * \brief SoakTester - runs Platform::procedureGo() on simulated robots with random and adversarial
+     *        commands in all cores and looks for worst tick latency and failures.
+     *        State is checked after every tick: phases are valid, at most three legs and never two
+     *        neighbor legs are in air, positions and joint angles are finite.
+     *        Collision check, velocity limiter, contact source, gait cache, shared memory (with commands
+     *        sent through it) and multi-rate threads are switched on and off at random.
+     *        Commands depend only on episode seed, so every failure can be repeated; while multi-rate
+     *        threads run ticks depend on thread timing, those parts of an episode are not exact
+     */
+    class SoakTester
+    {
+    public:
+        explicit SoakTester(const SoakConfig &config);
+        SoakReport run() const;
+        /*!
+         * \brief replay - run one episode again in this thread
+         */
+        SoakReport replay(std::uint64_t seed) const;
+
+    private:
+        class Histogram;
+        void runEpisode(std::uint64_t seed, SoakReport &report, Histogram &latency) const;
+
+        SoakConfig m_config;
+    };
+}